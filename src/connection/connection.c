@@ -28,6 +28,9 @@
 static uint8_t tracker_id, batt, batt_v, sensor_temp, imu_id, mag_id, tracker_status;
 static uint8_t tracker_svr_status = SVR_STATUS_OK;
 static float sensor_q[4], sensor_a[3], sensor_m[3];
+static uint16_t sensor_timestamp;
+static uint8_t mem_stack_free;
+static uint16_t mem_heap_peak, mem_heap_free;
 
 LOG_MODULE_REGISTER(connection, LOG_LEVEL_INF);
 
@@ -78,6 +81,11 @@ void connection_update_sensor_mag(float *m)
 	memcpy(sensor_m, m, sizeof(sensor_m));
 }
 
+void connection_update_sensor_timestamp(int64_t ticks)
+{
+	sensor_timestamp = k_ticks_to_us_floor64(ticks) / 100; // 0.1ms, wraps every 6.5536s
+}
+
 void connection_update_sensor_temp(float temp)
 {
 	// sensor_temp == zero means no data
@@ -121,12 +129,40 @@ void connection_update_status(int status)
 	tracker_svr_status = get_server_constant_tracker_status(status);
 }
 
+void connection_update_mem_stats(uint8_t stack_free_percent, size_t heap_peak, size_t heap_free)
+{
+	mem_stack_free = stack_free_percent;
+	mem_heap_peak = MIN(heap_peak, UINT16_MAX);
+	mem_heap_free = MIN(heap_free, UINT16_MAX);
+}
+
 //|b0      |b1      |b2      |b3      |b4      |b5      |b6      |b7      |b8      |b9      |b10     |b11     |b12     |b13     |b14     |b15     |
 //|type    |id      |packet data                                                                                                                  |
 //|0       |id      |batt    |batt_v  |temp    |brd_id  |mcu_id  |resv    |imu_id  |mag_id  |fw_date          |major   |minor   |patch   |rssi    |
 //|1       |id      |q0               |q1               |q2               |q3               |a0               |a1               |a2               |
 //|2       |id      |batt    |batt_v  |temp    |q_buf                              |a0               |a1               |a2               |rssi    |
 //|3	   |id      |svr_stat|status  |resv                                                                                              |rssi    |
+//|3	   |id      |svr_stat|status  |stack   |heap_peak        |heap_free        |resv                                                 |rssi    | (memory statistics)
+//|4       |id      |q0               |q1               |q2               |q3               |m0               |m1               |m2               |
+//|5       |id      |q_buf                              |a0               |a1               |a2               |timestamp        |resv    |rssi    |
+// packet 5 timestamp: capture time of the newest fused sample in 0.1ms, estimated as the FIFO read time minus half a gyro sample period
+
+// packet 0 resv
+#define CONNECTION_CAP_TIMESTAMP 0x01 // packet 5 may be sent
+#define CONNECTION_CAP_MEM_STATS 0x02 // packet 3 carries memory statistics
+
+#define CONNECTION_CAPS ((IS_ENABLED(CONFIG_CONNECTION_USE_TIMESTAMP) ? CONNECTION_CAP_TIMESTAMP : 0) \
+			 | (IS_ENABLED(CONFIG_CONNECTION_USE_MEM_STATS) ? CONNECTION_CAP_MEM_STATS : 0))
+
+static uint32_t connection_q_buf(void) // reduced precision quat
+{
+	float v[3] = {0};
+	q_fem(sensor_q, v); // exponential map
+	for (int i = 0; i < 3; i++)
+		v[i] = (v[i] + 1) / 2; // map -1-1 to 0-1
+	uint16_t v_buf[3] = {SATURATE_UINT10((1 << 10) * v[0]), SATURATE_UINT11((1 << 11) * v[1]), SATURATE_UINT11((1 << 11) * v[2])}; // fill 32 bits
+	return v_buf[0] | (v_buf[1] << 10) | (v_buf[2] << 21);
+}
 
 void connection_write_packet_0() // device info
 {
@@ -138,7 +174,7 @@ void connection_write_packet_0() // device info
 	data[4] = sensor_temp; // temp
 	data[5] = FW_BOARD; // brd_id
 	data[6] = FW_MCU; // mcu_id
-	data[7] = 0; // resv
+	data[7] = CONNECTION_CAPS; // resv, capabilities
 	data[8] = imu_id; // imu_id
 	data[9] = mag_id; // mag_id
 	uint16_t *buf = (uint16_t *)&data[10];
@@ -174,13 +210,8 @@ void connection_write_packet_2() // reduced precision quat and accel with batter
 	data[2] = batt;
 	data[3] = batt_v;
 	data[4] = sensor_temp; // temp
-	float v[3] = {0};
-	q_fem(sensor_q, v); // exponential map
-	for (int i = 0; i < 3; i++)
-		v[i] = (v[i] + 1) / 2; // map -1-1 to 0-1
-	uint16_t v_buf[3] = {SATURATE_UINT10((1 << 10) * v[0]), SATURATE_UINT11((1 << 11) * v[1]), SATURATE_UINT11((1 << 11) * v[2])}; // fill 32 bits
 	uint32_t *q_buf = (uint32_t *)&data[5];
-	*q_buf = v_buf[0] | (v_buf[1] << 10) | (v_buf[2] << 21);
+	*q_buf = connection_q_buf();
 
 //	v[0] = FIXED_10_TO_DOUBLE(*q_buf & 1023);
 //	v[1] = FIXED_11_TO_DOUBLE((*q_buf >> 10) & 2047);
@@ -205,6 +236,12 @@ void connection_write_packet_3() // status
 	data[1] = tracker_id;
 	data[2] = tracker_svr_status;
 	data[3] = tracker_status;
+#if CONFIG_CONNECTION_USE_MEM_STATS
+	data[4] = mem_stack_free; // lowest free stack of any thread in percent
+	uint16_t *buf = (uint16_t *)&data[5];
+	buf[0] = mem_heap_peak; // bytes
+	buf[1] = mem_heap_free;
+#endif
 	data[15] = 0; // rssi (supplied by receiver)
 	esb_write(data);
 }
@@ -224,3 +261,20 @@ void connection_write_packet_4() // full precision quat and magnetometer
 	buf[6] = TO_FIXED_10(sensor_m[2]);
 	esb_write(data);
 }
+
+void connection_write_packet_5() // reduced precision quat and accel with timestamp
+{
+	uint8_t data[16] = {0};
+	data[0] = 5; // packet 5
+	data[1] = tracker_id;
+	uint32_t *q_buf = (uint32_t *)&data[2];
+	*q_buf = connection_q_buf();
+	uint16_t *buf = (uint16_t *)&data[6];
+	buf[0] = TO_FIXED_7(sensor_a[0]);
+	buf[1] = TO_FIXED_7(sensor_a[1]);
+	buf[2] = TO_FIXED_7(sensor_a[2]);
+	buf[3] = sensor_timestamp; // time of newest sample
+	data[14] = 0; // resv
+	data[15] = 0; // rssi (supplied by receiver)
+	esb_write(data);
+}
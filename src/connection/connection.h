@@ -34,6 +34,7 @@ void connection_set_id(uint8_t id);
 void connection_update_sensor_ids(int imu_id, int mag_id);
 void connection_update_sensor_data(float *q, float *a);
 void connection_update_sensor_mag(float *m);
+void connection_update_sensor_timestamp(int64_t ticks);
 void connection_update_sensor_temp(float temp);
 void connection_update_battery(
 	bool battery_available,
@@ -42,11 +43,13 @@ void connection_update_battery(
 	int battery_mV
 );
 void connection_update_status(int status);
+void connection_update_mem_stats(uint8_t stack_free_percent, size_t heap_peak, size_t heap_free);
 
 void connection_write_packet_0();
 void connection_write_packet_1();
 void connection_write_packet_2();
 void connection_write_packet_3();
 void connection_write_packet_4();
+void connection_write_packet_5();
 
 #endif
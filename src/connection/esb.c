@@ -31,6 +31,8 @@
 #include <zephyr/sys/crc.h>
 
 #include "esb.h"
+#include "receiver.h"
+#include "system/work.h"
 
 uint8_t last_reset = 0;
 //const nrfx_timer_t m_timer = NRFX_TIMER_INSTANCE(1);
@@ -51,13 +53,47 @@ static struct esb_payload tx_payload_pair = ESB_CREATE_PAYLOAD(0,
 
 static uint8_t paired_addr[8] = {0};
 
+#define ESB_DEFAULT_CHANNEL 2
+
+// Pairing sweeps these channels, the default channel is first for receivers that do not sweep
+static const uint8_t esb_pair_channels[] = {ESB_DEFAULT_CHANNEL, 26, 50, 74};
+#define ESB_PAIR_BACKOFF_MIN 16 // ms
+#define ESB_PAIR_BACKOFF_MAX 1024 // ms
+
+static K_SEM_DEFINE(pair_sem, 0, 1);
+static bool pair_tx_success = false;
+
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+#define ESB_HOP_REQUEST_ERRORS 25 // consecutive failures before asking the receiver to hop
+#define ESB_HOP_REQUEST_INTERVAL 1000 // ms
+
+static struct esb_payload tx_payload_hop = ESB_CREATE_PAYLOAD(0,
+														  ESB_HOP_PAYLOAD, 0);
+
+static uint8_t hop_channels[ESB_HOP_CHANNELS] = {ESB_DEFAULT_CHANNEL};
+static uint8_t hop_index = 0;
+static int hop_request = -1;
+static bool hop_request_send = false;
+static int64_t hop_request_time = 0;
+static uint32_t hop_errors = 0;
+static uint32_t hop_tx_success[ESB_HOP_CHANNELS] = {0};
+static uint32_t hop_tx_failed[ESB_HOP_CHANNELS] = {0};
+#endif
+
 static bool esb_initialized = false;
 static bool esb_paired = false;
 
 LOG_MODULE_REGISTER(esb_event, LOG_LEVEL_INF);
 
+#define ESB_CHECK_INTERVAL_MS 100
+
+static K_SEM_DEFINE(esb_pair_request_sem, 0, 1);
+
 static void esb_thread(void);
-K_THREAD_DEFINE(esb_thread_id, 512, esb_thread, NULL, NULL, NULL, 6, 0, 0);
+K_THREAD_DEFINE(esb_thread_id, 512, esb_thread, NULL, NULL, NULL, 6, 0, 0); // pairing, blocks until paired
+
+static void esb_check_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(esb_check_work, esb_check_work_handler);
 
 void event_handler(struct esb_evt const *event)
 {
@@ -67,8 +103,23 @@ void event_handler(struct esb_evt const *event)
 		if (tx_errors >= 100)
 			set_status(SYS_STATUS_CONNECTION_ERROR, false);
 		tx_errors = 0;
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+		if (esb_paired)
+		{
+			hop_tx_success[hop_index]++;
+			hop_errors = 0;
+		}
+#endif
 		if (esb_paired)
+		{
 			clocks_stop();
+			sys_boot_mark(SYS_BOOT_PHASE_PACKET);
+		}
+		else
+		{
+			pair_tx_success = true;
+			k_sem_give(&pair_sem);
+		}
 		break;
 	case ESB_EVENT_TX_FAILED:
 		if (++tx_errors == 100) // consecutive failure to transmit
@@ -77,8 +128,20 @@ void event_handler(struct esb_evt const *event)
 			set_status(SYS_STATUS_CONNECTION_ERROR, true);
 		}
 		LOG_DBG("TX FAILED");
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+		if (esb_paired)
+		{
+			hop_tx_failed[hop_index]++;
+			hop_errors++;
+		}
+#endif
 		if (esb_paired)
 			clocks_stop();
+		else
+		{
+			pair_tx_success = false;
+			k_sem_give(&pair_sem);
+		}
 		break;
 	case ESB_EVENT_RX_RECEIVED:
 		if (!esb_read_rx_payload(&rx_payload)) // zero, rx success
@@ -87,10 +150,21 @@ void event_handler(struct esb_evt const *event)
 			{
 				LOG_DBG("tx: %16llX rx: %16llX", *(uint64_t *)tx_payload_pair.data, *(uint64_t *)rx_payload.data);
 				if (rx_payload.length == 8 && tx_payload_pair.data[1] == 1) // ack to second packet in pairing burst
+				{
 					memcpy(paired_addr, rx_payload.data, sizeof(paired_addr));
+					k_sem_give(&pair_sem);
+				}
 			}
 			else
 			{
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+				if (rx_payload.length == 3 && rx_payload.data[0] == ESB_HOP_PAYLOAD) // receiver announced a hop
+				{
+					hop_request = rx_payload.data[1] % ESB_HOP_CHANNELS;
+					k_work_reschedule_for_queue(&sys_work_q, &esb_check_work, K_MSEC(rx_payload.data[2] * 10)); // hop at the same time as the receiver
+					break;
+				}
+#endif
 				if (rx_payload.length == 4)
 				{
 					// TODO: Device should never receive packets if it is already paired, why is this packet received?
@@ -194,20 +268,27 @@ void clocks_stop(void)
 BUILD_ASSERT(false, "No Clock Control driver");
 #endif
 
-static struct k_thread clocks_thread_id;
-static K_THREAD_STACK_DEFINE(clocks_thread_id_stack, 128);
+static void clocks_start_work_handler(struct k_work *work)
+{
+	clocks_start();
+}
 
-void clocks_request_start(uint32_t delay_us)
+static void clocks_stop_work_handler(struct k_work *work)
 {
-	k_thread_create(&clocks_thread_id, clocks_thread_id_stack, K_THREAD_STACK_SIZEOF(clocks_thread_id_stack), (k_thread_entry_t)clocks_start, NULL, NULL, NULL, 5, 0, K_USEC(delay_us));
+	clocks_stop();
 }
 
-static struct k_thread clocks_stop_thread_id;
-static K_THREAD_STACK_DEFINE(clocks_stop_thread_id_stack, 128);
+static K_WORK_DELAYABLE_DEFINE(clocks_start_work, clocks_start_work_handler);
+static K_WORK_DELAYABLE_DEFINE(clocks_stop_work, clocks_stop_work_handler);
+
+void clocks_request_start(uint32_t delay_us)
+{
+	k_work_reschedule_for_queue(&sys_work_q_high, &clocks_start_work, K_USEC(delay_us));
+}
 
 void clocks_request_stop(uint32_t delay_us)
 {
-	k_thread_create(&clocks_stop_thread_id, clocks_stop_thread_id_stack, K_THREAD_STACK_SIZEOF(clocks_stop_thread_id), (k_thread_entry_t)clocks_stop, NULL, NULL, NULL, 5, 0, K_USEC(delay_us));
+	k_work_reschedule_for_queue(&sys_work_q_high, &clocks_stop_work, K_USEC(delay_us));
 }
 
 // this was randomly generated
@@ -243,7 +324,11 @@ int esb_initialize(bool tx)
 	{
 		// config.protocol = ESB_PROTOCOL_ESB_DPL;
 		config.mode = ESB_MODE_PRX;
+#if CONFIG_CONNECTION_RECEIVER
+		config.event_handler = receiver_event_handler;
+#else
 		config.event_handler = event_handler;
+#endif
 		// config.bitrate = ESB_BITRATE_2MBPS;
 		// config.crc = ESB_CRC_16BIT;
 		config.tx_output_power = CONFIG_RADIO_TX_POWER;
@@ -266,6 +351,14 @@ int esb_initialize(bool tx)
 	if (!err)
 		esb_set_prefixes(addr_prefix, ARRAY_SIZE(addr_prefix));
 
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+	if (!err)
+		err = esb_set_rf_channel(esb_paired ? hop_channels[hop_index] : ESB_DEFAULT_CHANNEL); // discovery is always on the default channel
+#else
+	if (!err)
+		err = esb_set_rf_channel(ESB_DEFAULT_CHANNEL); // pairing may have left another channel
+#endif
+
 	if (err)
 	{
 		LOG_ERR("ESB initialization failed: %d", err);
@@ -316,6 +409,159 @@ inline void esb_set_addr_paired(void)
 	memcpy(addr_prefix, addr_buffer + 8, sizeof(addr_prefix));
 }
 
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+static void esb_set_hop_channels(void);
+#endif
+
+#if CONFIG_CONNECTION_RECEIVER
+void esb_set_addr_receiver(void)
+{
+	memcpy(&paired_addr[2], (uint8_t *)NRF_FICR->DEVICEADDR, 6); // Receiver address is the device address
+	esb_set_addr_paired();
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+	esb_set_hop_channels();
+#endif
+}
+#endif
+
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+// Hop sequence is derived from the receiver address, so the receiver and all of its trackers share it
+static void esb_set_hop_channels(void)
+{
+	uint32_t seed = crc32_ieee(&paired_addr[2], 6);
+	// One channel in each 10MHz band between 2410 and 2480 MHz, the first channel is the default channel
+	hop_channels[0] = ESB_DEFAULT_CHANNEL;
+	for (int i = 1; i < ESB_HOP_CHANNELS; i++)
+	{
+		seed = seed * 1664525 + 1013904223; // LCG
+		hop_channels[i] = 10 * i + (seed >> 24) % 10;
+	}
+	// Shuffle the order of the hops, keeping the default channel first
+	for (int i = ESB_HOP_CHANNELS - 1; i > 1; i--)
+	{
+		seed = seed * 1664525 + 1013904223;
+		int j = 1 + (seed >> 16) % i;
+		uint8_t tmp = hop_channels[i];
+		hop_channels[i] = hop_channels[j];
+		hop_channels[j] = tmp;
+	}
+	hop_index = 0;
+	hop_request = -1;
+	hop_request_send = false;
+	hop_errors = 0;
+	memset(hop_tx_success, 0, sizeof(hop_tx_success));
+	memset(hop_tx_failed, 0, sizeof(hop_tx_failed));
+	LOG_INF("Hop channels: %u %u %u %u %u %u %u %u", hop_channels[0], hop_channels[1], hop_channels[2], hop_channels[3], hop_channels[4], hop_channels[5], hop_channels[6], hop_channels[7]);
+}
+
+static void esb_hop(uint8_t index)
+{
+	if (esb_set_rf_channel(hop_channels[index])) // esb is not idle, try again later
+		return;
+	if (hop_index != index)
+		LOG_DBG("Channel %u -> %u", hop_channels[hop_index], hop_channels[index]);
+	hop_index = index;
+	if (retained->boot_channel != index)
+	{
+		retained->boot_channel = index; // used by a fast resume from system off
+		retained_update_section(RETAINED_SECTION_SYSTEM);
+	}
+}
+
+// Trackers only hop when the receiver announces it, so all trackers move together
+static void esb_hop_check(void)
+{
+	if (hop_request >= 0)
+	{
+		LOG_INF("Receiver moved to channel %u", hop_channels[hop_request]);
+		esb_hop(hop_request);
+		if (hop_index == hop_request)
+			hop_request = -1;
+	}
+	else if (tx_errors >= 100)
+	{
+		// Missed a hop or the receiver was restarted, the receiver returns to the default channel when it loses its trackers
+		if (hop_index != 0)
+		{
+			LOG_WRN("No response on channel %u, returning to default channel", hop_channels[hop_index]);
+			esb_hop(0);
+		}
+	}
+	else if (hop_errors >= ESB_HOP_REQUEST_ERRORS && k_uptime_get() - hop_request_time > ESB_HOP_REQUEST_INTERVAL)
+	{
+		LOG_WRN("Channel %u is unreliable, requesting hop", hop_channels[hop_index]);
+		hop_request_time = k_uptime_get();
+		hop_request_send = true; // sent in place of the next packet
+	}
+}
+
+#if CONFIG_CONNECTION_RECEIVER
+int esb_set_hop_channel(uint8_t index)
+{
+	int err = esb_set_rf_channel(hop_channels[index % ESB_HOP_CHANNELS]);
+	if (!err)
+		hop_index = index % ESB_HOP_CHANNELS;
+	return err;
+}
+
+uint8_t esb_get_hop_channel(uint8_t index)
+{
+	return hop_channels[index % ESB_HOP_CHANNELS];
+}
+#endif
+
+void esb_print_channels(void)
+{
+	printk("Channel: %u\n", hop_channels[hop_index]);
+	for (int i = 0; i < ESB_HOP_CHANNELS; i++)
+	{
+		uint32_t total = hop_tx_success[i] + hop_tx_failed[i];
+		if (total)
+			printk("Channel %u: %u packets, %.2f%% failed\n", hop_channels[i], total, (double)hop_tx_failed[i] * 100.0 / total);
+		else
+			printk("Channel %u: No packets\n", hop_channels[i]);
+	}
+}
+#else
+void esb_print_channels(void)
+{
+	printk("Channel: %u\n", ESB_DEFAULT_CHANNEL);
+}
+#endif
+
+void esb_set_pair_channel(uint8_t index)
+{
+	esb_set_rf_channel(esb_pair_channels[index % ARRAY_SIZE(esb_pair_channels)]);
+}
+
+uint8_t esb_get_pair_channel_count(void)
+{
+	return ARRAY_SIZE(esb_pair_channels);
+}
+
+// Send one packet of the pairing handshake and wait for the result
+static int esb_pair_send(uint8_t step)
+{
+	tx_payload_pair.data[1] = step;
+	k_sem_reset(&pair_sem);
+	pair_tx_success = false;
+	esb_write_payload(&tx_payload_pair);
+	esb_start_tx();
+	if (k_sem_take(&pair_sem, K_MSEC(10))) // retransmits are finished well before this
+		return -ETIMEDOUT;
+	return pair_tx_success ? 0 : -EIO;
+}
+
+// Exponential backoff with jitter, so trackers pairing at the same time do not stay in sync
+static uint32_t esb_pair_backoff(int attempt, uint32_t *seed)
+{
+	uint32_t delay = ESB_PAIR_BACKOFF_MIN << MIN(attempt, 6);
+	if (delay > ESB_PAIR_BACKOFF_MAX)
+		delay = ESB_PAIR_BACKOFF_MAX;
+	*seed = *seed * 1664525 + k_cycle_get_32(); // LCG mixed with cycle counter
+	return delay / 2 + (*seed >> 8) % (delay / 2 + 1);
+}
+
 void esb_set_pair(uint64_t addr)
 {
 	uint64_t *device_addr = (uint64_t *)NRF_FICR->DEVICEADDR; // Use device address as unique identifier (although it is not actually guaranteed, see datasheet)
@@ -356,6 +602,8 @@ void esb_pair(void)
 		LOG_INF("Checksum: %02X", checksum);
 		tx_payload_pair.data[0] = checksum; // Use checksum to make sure packet is for this device
 		set_led(SYS_LED_PATTERN_SHORT, SYS_LED_PRIORITY_CONNECTION);
+		uint32_t seed = crc32_ieee(&tx_payload_pair.data[2], 6);
+		int attempt = 0;
 		while (paired_addr[0] != checksum)
 		{
 			if (!esb_initialized)
@@ -365,25 +613,36 @@ void esb_pair(void)
 			}
 			if (!clock_status)
 				clocks_start();
-			if (paired_addr[0])
+			for (int i = 0; i < ARRAY_SIZE(esb_pair_channels); i++)
 			{
-				LOG_INF("Incorrect checksum: %02X", paired_addr[0]);
-				paired_addr[0] = 0; // Packet not for this device
+				if (esb_set_rf_channel(esb_pair_channels[i]))
+					continue;
+				esb_flush_rx();
+				esb_flush_tx();
+				if (esb_pair_send(0)) // send pairing request, no receiver on this channel
+					continue;
+				if (esb_pair_send(1)) // receive ack data
+					continue;
+				if (!paired_addr[0])
+					k_sem_take(&pair_sem, K_MSEC(2)); // ack payload is received after tx success
+				if (paired_addr[0] && paired_addr[0] != checksum)
+				{
+					LOG_INF("Incorrect checksum: %02X", paired_addr[0]);
+					paired_addr[0] = 0; // Packet not for this device
+					continue;
+				}
+				if (paired_addr[0] == checksum)
+				{
+					for (int j = 0; j < 3 && esb_pair_send(2); j++) // "acknowledge" pairing from receiver
+						;
+					LOG_INF("Paired on channel %u after %d attempts", esb_pair_channels[i], attempt + 1);
+					break;
+				}
 			}
-			esb_flush_rx();
-			esb_flush_tx();
-			tx_payload_pair.data[1] = 0; // send pairing request
-			esb_write_payload(&tx_payload_pair);
-			esb_start_tx();
-			k_msleep(2);
-			tx_payload_pair.data[1] = 1; // receive ack data
-			esb_write_payload(&tx_payload_pair);
-			esb_start_tx();
-			k_msleep(2);
-			tx_payload_pair.data[1] = 2; // "acknowledge" pairing from receiver
-			esb_write_payload(&tx_payload_pair);
-			esb_start_tx();
-			k_msleep(996);
+			if (paired_addr[0] == checksum)
+				break;
+			clocks_stop(); // not needed while waiting
+			k_msleep(esb_pair_backoff(attempt++, &seed));
 		}
 		set_led(SYS_LED_PATTERN_ONESHOT_COMPLETE, SYS_LED_PRIORITY_CONNECTION);
 		LOG_INF("Paired");
@@ -397,23 +656,35 @@ void esb_pair(void)
 	connection_set_id(paired_addr[1]);
 
 	esb_set_addr_paired();
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+	esb_set_hop_channels();
+#endif
 	esb_paired = true;
 	clocks_stop();
 }
 
 void esb_reset_pair(void)
 {
+#if CONFIG_CONNECTION_RECEIVER
+	receiver_pair(); // toggle pairing mode
+	return;
+#endif
 	if (paired_addr[0] || esb_paired)
 	{
 		esb_deinitialize(); // make sure esb is off
 		esb_paired = false;
 		memset(paired_addr, 0, sizeof(paired_addr));
+		k_sem_give(&esb_pair_request_sem);
 		LOG_INF("Pairing requested");
 	}
 }
 
 void esb_clear_pair(void)
 {
+#if CONFIG_CONNECTION_RECEIVER
+	receiver_clear_pair();
+	return;
+#endif
 	esb_reset_pair();
 	sys_write(PAIRED_ID, &retained->paired_addr, paired_addr, sizeof(paired_addr)); // write zeroes
 	LOG_INF("Pairing data reset");
@@ -432,17 +703,35 @@ void esb_write(uint8_t *data)
 #endif
 	memcpy(tx_payload.data, data, tx_payload.length);
 	esb_flush_tx(); // this will clear all transmissions even if they did not complete
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+	if (hop_request_send) // replaces this packet
+	{
+		hop_request_send = false;
+		tx_payload_hop.noack = tx_payload.noack;
+		tx_payload_hop.data[1] = paired_addr[1]; // tracker id
+		esb_write_payload(&tx_payload_hop);
+		send_data = true;
+		return;
+	}
+#endif
 	esb_write_payload(&tx_payload); // Add transmission to queue
 	send_data = true;
 }
 
 bool esb_ready(void)
 {
+#if CONFIG_CONNECTION_RECEIVER
+	return esb_initialized;
+#endif
 	return esb_initialized && esb_paired;
 }
 
 static void esb_thread(void)
 {
+#if CONFIG_CONNECTION_RECEIVER
+	receiver_thread();
+	return;
+#endif
 	// Read paired address from retained
 	memcpy(paired_addr, retained->paired_addr, sizeof(paired_addr));
 
@@ -451,18 +740,35 @@ static void esb_thread(void)
 		if (!esb_paired)
 		{
 			esb_pair();
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+			if (sys_boot_fast_resume()) // the receiver is likely still on the last channel
+				hop_index = retained->boot_channel % ESB_HOP_CHANNELS;
+#endif
 			esb_initialize(true);
+			sys_boot_mark(SYS_BOOT_PHASE_RADIO);
+			k_work_schedule_for_queue(&sys_work_q, &esb_check_work, K_NO_WAIT);
 		}
-		if (tx_errors >= 100)
-		{
-#if USER_SHUTDOWN_ENABLED
-			if (k_uptime_get() - last_tx_success > CONFIG_CONNECTION_TIMEOUT_DELAY) // shutdown if receiver is not detected
-			{
-				LOG_WRN("No response from receiver in %dm", CONFIG_CONNECTION_TIMEOUT_DELAY / 60000);
-				sys_request_system_off();
-			}
+		k_sem_take(&esb_pair_request_sem, K_FOREVER); // wait until pairing is requested again
+	}
+}
+
+static void esb_check_work_handler(struct k_work *work)
+{
+	if (!esb_paired)
+		return; // restarted by the pairing thread
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+	if (esb_initialized)
+		esb_hop_check();
 #endif
+	if (tx_errors >= 100)
+	{
+#if USER_SHUTDOWN_ENABLED
+		if (k_uptime_get() - last_tx_success > CONFIG_CONNECTION_TIMEOUT_DELAY) // shutdown if receiver is not detected
+		{
+			LOG_WRN("No response from receiver in %dm", CONFIG_CONNECTION_TIMEOUT_DELAY / 60000);
+			sys_request_system_off();
 		}
-		k_msleep(100);
+#endif
 	}
+	k_work_schedule_for_queue(&sys_work_q, &esb_check_work, sys_sleep_timeout(ESB_CHECK_INTERVAL_MS));
 }
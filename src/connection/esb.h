@@ -48,8 +48,19 @@ void esb_deinitialize(void);
 
 void esb_set_addr_discovery(void);
 void esb_set_addr_paired(void);
+void esb_set_addr_receiver(void);
 
 void esb_set_pair(uint64_t addr);
+void esb_set_pair_channel(uint8_t index);
+uint8_t esb_get_pair_channel_count(void);
+
+// Hop requests from trackers are |0x48|id|, hop announcements in the receiver ack payload are |0x48|channel index|delay (10ms)|
+#define ESB_HOP_PAYLOAD 0x48
+#define ESB_HOP_CHANNELS 8
+
+int esb_set_hop_channel(uint8_t index);
+uint8_t esb_get_hop_channel(uint8_t index);
+void esb_print_channels(void);
 
 void esb_pair(void);
 void esb_reset_pair(void);
@@ -0,0 +1,483 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2025 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#include "globals.h"
+#include "system/system.h"
+#include "esb.h"
+
+#if CONFIG_CONNECTION_RECEIVER
+
+#include <zephyr/usb/usb_device.h>
+#include <zephyr/usb/class/usb_hid.h>
+#include <zephyr/sys/atomic.h>
+
+#include "receiver.h"
+
+LOG_MODULE_REGISTER(receiver, LOG_LEVEL_INF);
+
+#define RECEIVER_PACKET_SIZE 16
+#define RECEIVER_REPORT_PACKETS 4 // packets per HID report
+#define RECEIVER_REPORT_SIZE (RECEIVER_PACKET_SIZE * RECEIVER_REPORT_PACKETS)
+#define RECEIVER_REPORT_QUEUE 8 // reports waiting for the host, must be a power of 2
+#define RECEIVER_PAIRING_TIMEOUT 60000 // leave pairing mode if no tracker paired in this time (ms)
+#define RECEIVER_TIMESTAMP_WINDOW 1000 // timestamps older than this can not be compared (ms)
+#define RECEIVER_PAIR_CHANNEL_DWELL 250 // time on each pairing channel, trackers sweep all channels much faster (ms)
+#define RECEIVER_HOP_ANNOUNCE 500 // trackers are told about a hop this long before it happens (ms)
+#define RECEIVER_HOP_MIN_INTERVAL 5000 // hop requests are ignored this long after a hop (ms)
+#define RECEIVER_HOP_HOLD 60000 // time on another channel before returning to the default channel, where trackers that missed a hop are waiting (ms)
+#define RECEIVER_HOP_SILENCE 10000 // return to the default channel immediately if no tracker is heard for this long (ms)
+
+/* Packets sent to the host are the tracker packets as received, with rssi in the last byte
+ * Packet 255 is sent by the receiver when a tracker is paired:
+ * |255|id|addr(6)|resv(8)|
+ * Unused packets in a report are filled with 0xFF
+ */
+#define RECEIVER_PACKET_REGISTER 255
+
+struct receiver_tracker {
+	uint16_t last_timestamp;
+	int64_t last_time;
+	int8_t rssi;
+	uint32_t packets;
+	uint32_t stale; // older timestamp than previous packet
+	uint32_t coalesced; // replaced by a newer packet before reaching the host
+	uint32_t dropped; // report queue full
+};
+
+static struct {
+	uint8_t count;
+	uint8_t addr[CONFIG_CONNECTION_RECEIVER_MAX_TRACKERS][6];
+} stored_trackers = {0};
+
+static struct receiver_tracker trackers[CONFIG_CONNECTION_RECEIVER_MAX_TRACKERS] = {0};
+
+static struct esb_payload rx_payload;
+static struct esb_payload ack_payload = ESB_CREATE_PAYLOAD(0,
+														   0, 0, 0, 0, 0, 0, 0, 0);
+
+// Reports are filled in place from the radio interrupt, then handed to the USB stack as is
+static uint8_t reports[RECEIVER_REPORT_QUEUE][RECEIVER_REPORT_SIZE];
+static uint8_t report_count[RECEIVER_REPORT_QUEUE] = {0};
+static uint8_t report_head = 0; // report being filled
+static uint8_t report_tail = 0; // oldest report, sent to host first
+
+static const struct device *hid_dev;
+static atomic_t hid_busy = ATOMIC_INIT(0);
+static K_SEM_DEFINE(report_sem, 0, 1);
+
+static bool pairing = false;
+static bool pairing_requested = false;
+static bool store_requested = false;
+static int64_t pairing_time = 0;
+static uint8_t pair_channel = 0;
+static int64_t pair_channel_time = 0;
+
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+static struct esb_payload hop_payload = ESB_CREATE_PAYLOAD(0,
+														   ESB_HOP_PAYLOAD, 0, 0);
+static uint8_t hop_index = 0;
+static int hop_next = -1; // announced channel index
+static int64_t hop_time = 0; // time of the announced hop, or of the last hop
+static int64_t last_packet_time = 0;
+#endif
+
+static const uint8_t hid_report_desc[] = {
+	HID_USAGE_PAGE(HID_USAGE_GEN_DESKTOP),
+	HID_USAGE(HID_USAGE_GEN_DESKTOP_UNDEFINED),
+	HID_COLLECTION(HID_COLLECTION_APPLICATION),
+		HID_USAGE(HID_USAGE_GEN_DESKTOP_UNDEFINED),
+		HID_REPORT_SIZE(8),
+		HID_REPORT_COUNT(RECEIVER_REPORT_SIZE),
+		HID_LOGICAL_MIN8(0),
+		HID_LOGICAL_MAX16(0xFF, 0x00),
+		HID_INPUT(0x02),
+	HID_END_COLLECTION,
+};
+
+#define NEXT_REPORT(x) (((x) + 1) & (RECEIVER_REPORT_QUEUE - 1))
+
+// Called with interrupts locked or from the radio interrupt
+static bool receiver_queue_packet(const uint8_t *data, struct receiver_tracker *tracker)
+{
+	uint8_t *report = reports[report_head];
+	uint8_t count = report_count[report_head];
+	// Only the newest packet of each type from a tracker is needed, replace it if the host has not received it yet
+	for (int i = 0; i < count; i++)
+	{
+		uint8_t *packet = &report[i * RECEIVER_PACKET_SIZE];
+		if (packet[0] == data[0] && packet[1] == data[1] && data[0] != RECEIVER_PACKET_REGISTER)
+		{
+			memcpy(packet, data, RECEIVER_PACKET_SIZE);
+			if (tracker)
+				tracker->coalesced++;
+			return true;
+		}
+	}
+	if (count == RECEIVER_REPORT_PACKETS)
+	{
+		if (NEXT_REPORT(report_head) == report_tail) // host is not keeping up
+		{
+			if (tracker)
+				tracker->dropped++;
+			return false;
+		}
+		report_head = NEXT_REPORT(report_head);
+		report_count[report_head] = 0;
+		report = reports[report_head];
+		count = 0;
+	}
+	memcpy(&report[count * RECEIVER_PACKET_SIZE], data, RECEIVER_PACKET_SIZE);
+	report_count[report_head] = count + 1;
+	return true;
+}
+
+static int receiver_find_tracker(const uint8_t *addr)
+{
+	for (int i = 0; i < stored_trackers.count; i++)
+		if (!memcmp(stored_trackers.addr[i], addr, 6))
+			return i;
+	return -1;
+}
+
+static void receiver_handle_pair(void)
+{
+	const uint8_t *addr = &rx_payload.data[2];
+	int id = receiver_find_tracker(addr);
+	switch (rx_payload.data[1])
+	{
+	case 0: // pairing request, the response is sent in the ack to the next packet
+		if (id < 0)
+			id = stored_trackers.count;
+		if (id >= CONFIG_CONNECTION_RECEIVER_MAX_TRACKERS)
+		{
+			LOG_WRN("Too many trackers");
+			return;
+		}
+		ack_payload.pipe = rx_payload.pipe;
+		ack_payload.data[0] = rx_payload.data[0]; // checksum from tracker
+		ack_payload.data[1] = id;
+		memcpy(&ack_payload.data[2], (uint8_t *)NRF_FICR->DEVICEADDR, 6);
+		esb_flush_tx(); // remove ack for any other tracker
+		esb_write_payload(&ack_payload);
+		break;
+	case 2: // tracker received the address
+		if (id < 0)
+		{
+			if (stored_trackers.count >= CONFIG_CONNECTION_RECEIVER_MAX_TRACKERS || ack_payload.data[0] != rx_payload.data[0])
+				return;
+			id = stored_trackers.count++;
+			memcpy(stored_trackers.addr[id], addr, 6);
+			store_requested = true;
+			pairing_time = k_uptime_get();
+			k_sem_give(&report_sem);
+		}
+		uint8_t data[RECEIVER_PACKET_SIZE];
+		memset(data, 0, sizeof(data));
+		data[0] = RECEIVER_PACKET_REGISTER;
+		data[1] = id;
+		memcpy(&data[2], addr, 6);
+		receiver_queue_packet(data, NULL);
+		break;
+	default:
+		break;
+	}
+}
+
+static void receiver_handle_packet(void)
+{
+	uint8_t *data = rx_payload.data;
+	uint8_t id = data[1];
+	if (id >= stored_trackers.count)
+		return; // not paired to this receiver
+	struct receiver_tracker *tracker = &trackers[id];
+	int64_t time = k_uptime_get();
+	tracker->packets++;
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+	last_packet_time = time;
+#endif
+	tracker->rssi = -rx_payload.rssi;
+	// Retransmits are already discarded by ESB (same PID and CRC), identical content is a valid packet from a tracker at rest
+	// Stop-and-wait delivery keeps packets from a tracker in order, and only the newest packet of each type is forwarded
+	// A packet with an older timestamp is a late retransmit or from before a tracker restart, it is dropped instead of reordered
+	if (data[0] == 5)
+	{
+		uint16_t timestamp = data[12] | (data[13] << 8);
+		if (time - tracker->last_time < RECEIVER_TIMESTAMP_WINDOW && (int16_t)(timestamp - tracker->last_timestamp) <= 0)
+		{
+			tracker->stale++;
+			return;
+		}
+		tracker->last_timestamp = timestamp;
+	}
+	tracker->last_time = time;
+	data[RECEIVER_PACKET_SIZE - 1] = rx_payload.rssi;
+	if (receiver_queue_packet(data, tracker))
+		k_sem_give(&report_sem);
+}
+
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+// A tracker is failing to transmit, move all trackers to the next channel in the hop sequence
+static void receiver_handle_hop_request(void)
+{
+	if (rx_payload.data[1] >= stored_trackers.count || hop_next >= 0)
+		return; // not paired to this receiver, or a hop is already announced
+	int64_t time = k_uptime_get();
+	if (time - hop_time < RECEIVER_HOP_MIN_INTERVAL)
+		return; // trackers are still following the last hop
+	hop_next = (hop_index + 1) % ESB_HOP_CHANNELS;
+	hop_time = time + RECEIVER_HOP_ANNOUNCE;
+	k_sem_give(&report_sem);
+}
+
+// The announcement is sent in the ack to the next packet, from any tracker
+static void receiver_announce_hop(void)
+{
+	int64_t remaining = hop_time - k_uptime_get();
+	hop_payload.data[1] = hop_next;
+	hop_payload.data[2] = CLAMP(remaining / 10, 0, UINT8_MAX); // 10ms
+	esb_flush_tx(); // replace the previous announcement
+	esb_write_payload(&hop_payload);
+}
+#endif
+
+void receiver_event_handler(struct esb_evt const *event)
+{
+	if (event->evt_id != ESB_EVENT_RX_RECEIVED)
+		return;
+	while (!esb_read_rx_payload(&rx_payload)) // zero, rx success
+	{
+		if (pairing && rx_payload.length == 8)
+			receiver_handle_pair();
+		else if (!pairing && rx_payload.length == RECEIVER_PACKET_SIZE)
+			receiver_handle_packet();
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+		else if (!pairing && rx_payload.length == 2 && rx_payload.data[0] == ESB_HOP_PAYLOAD)
+			receiver_handle_hop_request();
+		if (!pairing && hop_next >= 0)
+			receiver_announce_hop();
+#endif
+	}
+}
+
+static void int_in_ready_cb(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+	unsigned int key = irq_lock();
+	report_tail = NEXT_REPORT(report_tail); // report was sent
+	irq_unlock(key);
+	atomic_clear(&hid_busy);
+	k_sem_give(&report_sem);
+}
+
+static const struct hid_ops ops = {
+	.int_in_ready = int_in_ready_cb,
+};
+
+static int receiver_hid_init(void)
+{
+	hid_dev = device_get_binding("HID_0");
+	if (hid_dev == NULL)
+	{
+		LOG_ERR("Cannot get USB HID Device");
+		return -ENODEV;
+	}
+	usb_hid_register_device(hid_dev, hid_report_desc, sizeof(hid_report_desc), &ops);
+	return usb_hid_init(hid_dev);
+}
+
+SYS_INIT(receiver_hid_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY); // before usb is enabled
+
+static void receiver_send_report(void)
+{
+	if (atomic_get(&hid_busy))
+		return; // wait for the host to take the last report
+	unsigned int key = irq_lock();
+	if (report_tail == report_head && report_count[report_head]) // host is idle, do not wait for a full report
+	{
+		report_head = NEXT_REPORT(report_head);
+		report_count[report_head] = 0;
+	}
+	bool pending = report_tail != report_head;
+	irq_unlock(key);
+	if (!pending)
+		return;
+	uint8_t *report = reports[report_tail];
+	uint8_t count = report_count[report_tail];
+	memset(&report[count * RECEIVER_PACKET_SIZE], 0xFF, (RECEIVER_REPORT_PACKETS - count) * RECEIVER_PACKET_SIZE);
+	atomic_set(&hid_busy, 1);
+	if (hid_int_ep_write(hid_dev, report, RECEIVER_REPORT_SIZE, NULL))
+	{
+		// USB is not ready, drop the report
+		key = irq_lock();
+		report_tail = NEXT_REPORT(report_tail);
+		irq_unlock(key);
+		atomic_clear(&hid_busy);
+	}
+}
+
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+static void receiver_hop(uint8_t index)
+{
+	esb_stop_rx();
+	esb_flush_tx(); // remove the announcement
+	if (esb_set_hop_channel(index))
+		LOG_ERR("Failed to set channel");
+	else
+		LOG_INF("Channel %u", esb_get_hop_channel(index));
+	esb_start_rx();
+	unsigned int key = irq_lock();
+	hop_index = index;
+	hop_next = -1;
+	hop_time = k_uptime_get();
+	irq_unlock(key);
+}
+
+// Returns the time until the receiver needs to check again (ms)
+static int64_t receiver_hop_check(void)
+{
+	if (pairing)
+		return 100;
+	int64_t time = k_uptime_get();
+	unsigned int key = irq_lock();
+	if (hop_next < 0 && hop_index != 0 && time - hop_time > RECEIVER_HOP_HOLD)
+	{
+		// Announce the return, trackers that missed a hop have already returned to the default channel
+		hop_next = 0;
+		hop_time = time + RECEIVER_HOP_ANNOUNCE;
+	}
+	int next = hop_next;
+	int64_t remaining = hop_time - time;
+	bool silent = time - last_packet_time > RECEIVER_HOP_SILENCE;
+	irq_unlock(key);
+	if (next >= 0 && remaining <= 0)
+		receiver_hop(next);
+	else if (next >= 0)
+		return MIN(remaining, 100);
+	else if (hop_index != 0 && silent)
+		receiver_hop(0); // all trackers are lost, they return to the default channel
+	return 100;
+}
+#endif
+
+static void receiver_start(void)
+{
+	esb_deinitialize();
+	if (pairing)
+		esb_set_addr_discovery();
+	else
+		esb_set_addr_receiver();
+	esb_initialize(false); // always starts on the default channel
+	pair_channel = 0;
+	pair_channel_time = k_uptime_get();
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+	hop_index = 0;
+	hop_next = -1;
+	hop_time = k_uptime_get();
+#endif
+	esb_start_rx();
+}
+
+void receiver_thread(void)
+{
+	sys_read(RECEIVER_TRACKERS_ID, &stored_trackers, sizeof(stored_trackers));
+	if (stored_trackers.count > CONFIG_CONNECTION_RECEIVER_MAX_TRACKERS)
+		stored_trackers.count = 0; // stored with different configuration
+	LOG_INF("Paired trackers: %u", stored_trackers.count);
+	clocks_start(); // receiver is always listening
+	receiver_start();
+
+	while (1)
+	{
+#if CONFIG_CONNECTION_USE_CHANNEL_HOPPING
+		k_sem_take(&report_sem, K_MSEC(receiver_hop_check()));
+#else
+		k_sem_take(&report_sem, K_MSEC(100));
+#endif
+		receiver_send_report();
+		if (pairing_requested)
+		{
+			pairing_requested = false;
+			pairing = !pairing;
+			pairing_time = k_uptime_get();
+			LOG_INF(pairing ? "Pairing" : "Pairing stopped");
+			set_led(pairing ? SYS_LED_PATTERN_SHORT : SYS_LED_PATTERN_OFF, SYS_LED_PRIORITY_CONNECTION);
+			receiver_start();
+		}
+		else if (pairing && k_uptime_get() - pairing_time > RECEIVER_PAIRING_TIMEOUT)
+		{
+			pairing_requested = true;
+		}
+		else if (pairing && k_uptime_get() - pair_channel_time > RECEIVER_PAIR_CHANNEL_DWELL)
+		{
+			// Slowly sweep pairing channels
+			pair_channel = (pair_channel + 1) % esb_get_pair_channel_count();
+			pair_channel_time = k_uptime_get();
+			esb_stop_rx();
+			esb_set_pair_channel(pair_channel);
+			esb_start_rx();
+		}
+		if (store_requested)
+		{
+			store_requested = false;
+			LOG_INF("Paired tracker %u", stored_trackers.count - 1);
+			sys_write(RECEIVER_TRACKERS_ID, NULL, &stored_trackers, sizeof(stored_trackers));
+		}
+	}
+}
+
+void receiver_pair(void)
+{
+	pairing_requested = true;
+	k_sem_give(&report_sem);
+}
+
+void receiver_clear_pair(void)
+{
+	unsigned int key = irq_lock();
+	stored_trackers.count = 0;
+	memset(stored_trackers.addr, 0, sizeof(stored_trackers.addr));
+	memset(trackers, 0, sizeof(trackers));
+	irq_unlock(key);
+	sys_write(RECEIVER_TRACKERS_ID, NULL, &stored_trackers, sizeof(stored_trackers));
+	LOG_INF("Pairing data reset");
+}
+
+void receiver_print_trackers(void)
+{
+	printk("Paired trackers: %u/%u\n", stored_trackers.count, CONFIG_CONNECTION_RECEIVER_MAX_TRACKERS);
+	int64_t time = k_uptime_get();
+	for (int i = 0; i < stored_trackers.count; i++)
+	{
+		struct receiver_tracker *tracker = &trackers[i];
+		const uint8_t *addr = stored_trackers.addr[i];
+		printk("Tracker %u: %02X%02X%02X%02X%02X%02X", i, addr[5], addr[4], addr[3], addr[2], addr[1], addr[0]);
+		if (!tracker->packets)
+		{
+			printk(", No packets\n");
+			continue;
+		}
+		printk(", %d dBm, last forwarded %lldms ago\n", tracker->rssi, time - tracker->last_time);
+		printk("    %u packets, %u stale, %u coalesced, %u dropped\n", tracker->packets, tracker->stale, tracker->coalesced, tracker->dropped);
+	}
+}
+
+#endif
@@ -1,9 +1,12 @@
 #include "globals.h"
 #include "system/system.h"
 #include "system/battery_tracker.h"
+#include "system/mem.h"
 #include "sensor/sensor.h"
 #include "sensor/calibration.h"
+#include "sensor/range.h"
 #include "connection/esb.h"
+#include "connection/receiver.h"
 #include "build_defines.h"
 
 #if CONFIG_USB_DEVICE_STACK
@@ -104,6 +107,7 @@ static const char *meow_suffixes[] = {
 static void console_thread_create(void)
 {
 	k_thread_create(&console_thread_id, console_thread_id_stack, K_THREAD_STACK_SIZEOF(console_thread_id_stack), (k_thread_entry_t)console_thread, NULL, NULL, NULL, 6, 0, K_NO_WAIT);
+	k_thread_name_set(&console_thread_id, "console");
 }
 
 #if USB_EXISTS
@@ -194,9 +198,10 @@ static void print_connection(void)
 #if CONFIG_SENSOR_USE_SENS_CALIBRATION
 	// Display Gyro sensitivity
 	if (retained) {
-				float scale_x = retained->gyroSensScale[0];
-				float scale_y = retained->gyroSensScale[1];
-				float scale_z = retained->gyroSensScale[2];
+				int sens = sensor_range_sens_index(); // current gyro range
+				float scale_x = retained->gyroSensScale[sens][0];
+				float scale_y = retained->gyroSensScale[sens][1];
+				float scale_z = retained->gyroSensScale[sens][2];
 			
 				// Calculate the approximate input degrees difference based on the stored scale factor
 				// degrees = (1.0 - (1.0 / scale)) * 360.0 * number of revolutions
@@ -210,6 +215,10 @@ static void print_connection(void)
 		}
 #endif		
 	printk(paired ? "Receiver address: %012llX\n" : "Receiver address: None\n", (*(uint64_t *)&retained->paired_addr[0] >> 16) & 0xFFFFFFFFFFFF);
+	esb_print_channels();
+#if CONFIG_CONNECTION_RECEIVER
+	receiver_print_trackers();
+#endif
 }
 
 static void print_battery(void)
@@ -378,6 +387,7 @@ static void console_thread(void)
 		sys_request_system_reboot();
 #endif
 #if NRF5_BOOTLOADER
+		sys_flush();
 		gpio_pin_configure(gpio_dev, 19, GPIO_OUTPUT | GPIO_OUTPUT_INIT_LOW);
 #endif
 	}
@@ -393,6 +403,9 @@ static void console_thread(void)
 	printk(FW_STRING);
 	printk("info                         Get device information\n");
 	printk("uptime                       Get device uptime\n");
+	printk("boot                         Get boot timing\n");
+	printk("mem                          Get stack and heap usage\n");
+	printk("sleep                        Get idle time\n");
 	printk("reboot                       Soft reset the device\n");
 	printk("battery                      Get battery information\n");
 	printk("scan                         Restart sensor scan\n");
@@ -404,6 +417,9 @@ static void console_thread(void)
 
 	uint8_t command_info[] = "info";
 	uint8_t command_uptime[] = "uptime";
+	uint8_t command_boot[] = "boot";
+	uint8_t command_mem[] = "mem";
+	uint8_t command_sleep[] = "sleep";
 	uint8_t command_reboot[] = "reboot";
 	uint8_t command_battery[] = "battery";
 	uint8_t command_scan[] = "scan";
@@ -484,6 +500,18 @@ static void console_thread(void)
 			print_uptime(uptime, "Uptime");
 			print_uptime(uptime - retained->uptime_latest + retained->uptime_sum, "Accumulated");
 		}
+		else if (memcmp(line, command_boot, sizeof(command_boot)) == 0)
+		{
+			sys_boot_print();
+		}
+		else if (memcmp(line, command_mem, sizeof(command_mem)) == 0)
+		{
+			sys_mem_print();
+		}
+		else if (memcmp(line, command_sleep, sizeof(command_sleep)) == 0)
+		{
+			sys_sleep_print();
+		}
 		else if (memcmp(line, command_reboot, sizeof(command_reboot)) == 0)
 		{
 			sys_request_system_reboot();
@@ -512,10 +540,12 @@ static void console_thread(void)
 			{
 				if (retained) {
 					printk("Resetting gyro sensitivity calibration.\n");
-					retained->gyroSensScale[0] = 1.0f;
-					retained->gyroSensScale[1] = 1.0f;
-					retained->gyroSensScale[2] = 1.0f;
-					retained_update(); // Save changes
+					for (int i = 0; i < GYRO_SENS_RANGES; i++) {
+						retained->gyroSensScale[i][0] = 1.0f;
+						retained->gyroSensScale[i][1] = 1.0f;
+						retained->gyroSensScale[i][2] = 1.0f;
+					}
+					retained_update_section(RETAINED_SECTION_CALIBRATION); // Save changes
 					sys_write(MAIN_GYRO_SENS_ID, &retained->gyroSensScale, retained->gyroSensScale, sizeof(retained->gyroSensScale));
 					printk("Gyro sensitivity reset.\n");
 				} else {
@@ -553,10 +583,11 @@ static void console_thread(void)
 						if (fabsf(den_x) < 1e-6f || fabsf(den_y) < 1e-6f || fabsf(den_z) < 1e-6f) {
 							printk("Error: Invalid input degrees leading to division by zero. Calibration not applied.\n");
 						} else {
-							retained->gyroSensScale[0] = 1.0f / den_x;
-							retained->gyroSensScale[1] = 1.0f / den_y;
-							retained->gyroSensScale[2] = 1.0f / den_z;
-							retained_update();
+							int sens = sensor_range_sens_index(); // applies to the current gyro range only
+							retained->gyroSensScale[sens][0] = 1.0f / den_x;
+							retained->gyroSensScale[sens][1] = 1.0f / den_y;
+							retained->gyroSensScale[sens][2] = 1.0f / den_z;
+							retained_update_section(RETAINED_SECTION_CALIBRATION);
 							sys_write(MAIN_GYRO_SENS_ID, &retained->gyroSensScale, retained->gyroSensScale, sizeof(retained->gyroSensScale));
 							printk("Gyro sensitivity difference set to: %.3f, %.3f, %.3f\n", (double)deg_x, (double)deg_y, (double)deg_z);
 						}
@@ -608,6 +639,7 @@ static void console_thread(void)
 			sys_request_system_reboot();
 #endif
 #if NRF5_BOOTLOADER
+			sys_flush();
 			gpio_pin_configure(gpio_dev, 19, GPIO_OUTPUT | GPIO_OUTPUT_INIT_LOW);
 #endif
 		}
@@ -51,6 +51,7 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
 int main(void)
 {
+	sys_boot_mark(SYS_BOOT_PHASE_MAIN);
 #if DT_NODE_HAS_PROP(ZEPHYR_USER_NODE, pwr_gpios)
     gpio_pin_configure_dt(&gnd, GPIO_OUTPUT_ACTIVE);
     gpio_pin_set_dt(&gnd, 0);
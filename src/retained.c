@@ -25,8 +25,24 @@
 
 struct retained_data *retained = (struct retained_data *)DT_REG_ADDR(MEMORY_REGION);
 
-#define RETAINED_CRC_OFFSET offsetof(struct retained_data, crc)
-#define RETAINED_CHECKED_SIZE (RETAINED_CRC_OFFSET + sizeof(retained->crc))
+#define RETAINED_SECTION(first, next, version) {offsetof(struct retained_data, first), offsetof(struct retained_data, next) - offsetof(struct retained_data, first), version}
+#define RETAINED_SECTION_LAST(first, version) {offsetof(struct retained_data, first), sizeof(struct retained_data) - offsetof(struct retained_data, first), version}
+
+// Bump the version of a section when its layout changes
+static const struct {
+	uint16_t offset;
+	uint16_t size;
+	uint8_t version;
+} retained_sections[RETAINED_SECTION_COUNT] = {
+	[RETAINED_SECTION_SYSTEM] = RETAINED_SECTION(build_timestamp, max_battery_pptt, 3),
+	[RETAINED_SECTION_BATTERY] = RETAINED_SECTION(max_battery_pptt, paired_addr, 1),
+	[RETAINED_SECTION_PAIRING] = RETAINED_SECTION(paired_addr, sensor_data, 1),
+	[RETAINED_SECTION_CALIBRATION] = RETAINED_SECTION(sensor_data, imu_addr, 2),
+	[RETAINED_SECTION_FUSION] = RETAINED_SECTION(fusion_id, build_timestamp, 3),
+	[RETAINED_SECTION_SCAN] = RETAINED_SECTION_LAST(imu_addr, 1),
+};
+
+static uint8_t retained_valid_sections;
 
 static uint64_t init_time;
 
@@ -39,55 +55,106 @@ static int retained_init(void)
 // TODO: priority?
 SYS_INIT(retained_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
 
+static uint32_t retained_section_crc(enum retained_section section)
+{
+	return crc32_ieee((const uint8_t *)retained + retained_sections[section].offset, retained_sections[section].size);
+}
+
+static void retained_section_reset(enum retained_section section)
+{
+	memset((uint8_t *)retained + retained_sections[section].offset, 0, retained_sections[section].size);
+	retained->version[section] = retained_sections[section].version;
+	switch (section)
+	{
+	case RETAINED_SECTION_SYSTEM:
+		retained->build_timestamp = BUILD_TIMESTAMP;
+		break;
+	case RETAINED_SECTION_CALIBRATION:
+		for (int i = 0; i < GYRO_SENS_RANGES; i++)
+		{
+			retained->gyroSensScale[i][0] = 1.0f;
+			retained->gyroSensScale[i][1] = 1.0f;
+			retained->gyroSensScale[i][2] = 1.0f;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
 bool retained_validate(void)
 {
-	NRF_STATIC_ASSERT((RETAINED_CHECKED_SIZE <= 1024), "Retained data size exceeds 1 KB limit");
+	NRF_STATIC_ASSERT((sizeof(struct retained_data) <= 1024), "Retained data size exceeds 1 KB limit");
 
 	uint64_t now = init_time;
 //	uint64_t now = k_uptime_ticks(); // Get current uptime in ticks as soon as possible
 
-	/* The residue of a CRC is what you get from the CRC over the
-	 * message catenated with its CRC.  This is the post-final-xor
-	 * residue for CRC-32 (CRC-32/ISO-HDLC) which Zephyr calls
-	 * crc32_ieee.
-	 */
-	const uint32_t residue = 0x2144df1c;
-	uint32_t crc = crc32_ieee((const uint8_t *)retained,
-				  RETAINED_CHECKED_SIZE);
-	bool valid = (crc == residue);
-
 	/* Check the build timestamp of the firmware that last updated
-	 * the retained data.
+	 * the retained data, the layout may be different in another
+	 * build so all sections are reset.  The fusion section is at a
+	 * fixed offset and is only checked by its version and CRC, so the
+	 * fusion state is kept across firmware updates.
 	 */
-	valid &= (retained->build_timestamp == BUILD_TIMESTAMP);
+	bool build_valid = sys_le32_to_cpu(retained->crc[RETAINED_SECTION_SYSTEM]) == retained_section_crc(RETAINED_SECTION_SYSTEM)
+			   && retained->build_timestamp == BUILD_TIMESTAMP;
 
-	/* If the CRC isn't valid or the build timestamp is different
-	 * from the current build timestamp, reset the retained data.
+	/* Reset each section with an invalid CRC or a different version.
 	 */
-	if (!valid) {
-		memset(retained, 0, sizeof(struct retained_data));
-		retained->build_timestamp = BUILD_TIMESTAMP;
-		retained->gyroSensScale[0] = 1.0f;
-		retained->gyroSensScale[1] = 1.0f;
-		retained->gyroSensScale[2] = 1.0f;
+	retained_valid_sections = 0;
+	for (int i = 0; i < RETAINED_SECTION_COUNT; i++) {
+		bool valid = (build_valid || i == RETAINED_SECTION_FUSION)
+			     && retained->version[i] == retained_sections[i].version
+			     && sys_le32_to_cpu(retained->crc[i]) == retained_section_crc(i);
+		if (valid)
+			retained_valid_sections |= BIT(i);
+		else
+			retained_section_reset(i);
 	}
 
 	/* Reset to accrue runtime from this session. */
 	retained->uptime_latest = now;
 	retained->battery_uptime_latest = now;
 
-	return valid;
+	return retained_valid_sections == BIT_MASK(RETAINED_SECTION_COUNT);
 }
 
-void retained_update(void)
+bool retained_section_valid(enum retained_section section)
+{
+	return retained_valid_sections & BIT(section);
+}
+
+static void retained_update_uptime(void)
 {
 	uint64_t now = k_uptime_ticks();
 
 	retained->uptime_sum += (now - retained->uptime_latest);
 	retained->uptime_latest = now;
 
-	uint32_t crc = crc32_ieee((const uint8_t *)retained,
-				  RETAINED_CRC_OFFSET);
+	retained->crc[RETAINED_SECTION_SYSTEM] = sys_cpu_to_le32(retained_section_crc(RETAINED_SECTION_SYSTEM));
+}
+
+void retained_update(void)
+{
+	for (int i = 0; i < RETAINED_SECTION_COUNT; i++)
+		retained->crc[i] = sys_cpu_to_le32(retained_section_crc(i));
+	retained_update_uptime();
+}
+
+void retained_update_section(enum retained_section section)
+{
+	if (section != RETAINED_SECTION_SYSTEM)
+		retained->crc[section] = sys_cpu_to_le32(retained_section_crc(section));
+	retained_update_uptime(); // system section is always updated
+}
 
-	retained->crc = sys_cpu_to_le32(crc);
+void retained_update_at(const void *ptr)
+{
+	size_t offset = (const uint8_t *)ptr - (const uint8_t *)retained;
+	for (int i = 0; i < RETAINED_SECTION_COUNT; i++) {
+		if (offset >= retained_sections[i].offset && offset < retained_sections[i].offset + retained_sections[i].size) {
+			retained_update_section(i);
+			return;
+		}
+	}
+	retained_update(); // not in a section
 }
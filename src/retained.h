@@ -11,7 +11,54 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/* Sections of the retained data, each is validated and updated on its
+ * own so a corrupt section does not invalidate the others.
+ */
+enum retained_section {
+	RETAINED_SECTION_SYSTEM,
+	RETAINED_SECTION_BATTERY,
+	RETAINED_SECTION_PAIRING,
+	RETAINED_SECTION_CALIBRATION,
+	RETAINED_SECTION_FUSION,
+	RETAINED_SECTION_SCAN,
+	RETAINED_SECTION_COUNT
+};
+
+/* Gyro sensitivity is stored for each gyro full scale, from 125dps
+ * doubling up to 4000dps, lower ranges share the first entry.
+ */
+#define GYRO_SENS_RANGES 6
+
+/* Compact snapshot of the convergent fusion state, independent of the
+ * internal structures of each fusion implementation.
+ */
+struct retained_fusion_state {
+	float q[4]; // orientation, w x y z
+	float gyro_bias[3]; // deg/s, as get_gyro_bias of the fusion
+	float gyro_bias_sigma; // standard deviation of the bias estimate in deg/s, negative if unknown
+	uint8_t rest; // rest detected
+};
+
 struct retained_data {
+	/* Layout version of each section, a section is reset if its
+	 * version changes.
+	 */
+	uint8_t version[RETAINED_SECTION_COUNT];
+
+	/* CRC of each section, used to validate the retained data.
+	 * These must be stored little-endian.
+	 */
+	uint32_t crc[RETAINED_SECTION_COUNT];
+
+	/* Fusion section.  This is kept at a fixed offset and does not
+	 * depend on the build, so it is not reset by a firmware update
+	 * unless its version changes.
+	 */
+	uint8_t fusion_id; // fusion_data_stored
+	struct retained_fusion_state fusion_state;
+
+	/* System section */
+
 	/* The build version of the firmware that last updated the
 	 * retained data.
 	 */
@@ -27,6 +74,24 @@ struct retained_data {
 	 */
 	uint64_t uptime_sum;
 
+	uint8_t reboot_counter;
+
+	/* NVS entries written to retained but not yet to flash, by ID */
+	uint32_t nvs_dirty;
+
+	/* Set right before system off with IMU wake up, the next boot
+	 * may reuse the sensor scan and radio state from this session.
+	 */
+	uint8_t boot_resume;
+	uint8_t boot_channel; // hop channel index in use
+
+	/* Time each boot phase was reached in us since reset, for the
+	 * last full boot and the last fast resume.  Zero if not reached.
+	 */
+	uint32_t boot_phase_us[2][8];
+
+	/* Battery section */
+
 	/* Battery statistics.  Tracking for discharge curve only begins
 	 * after ~3% discharged.  If battery_pptt has changed significantly
 	 * compared to min_battery_pptt since the last update,
@@ -48,9 +113,10 @@ struct retained_data {
 	/* Calibrated discharge curve */
 	int16_t battery_pptt_curve[18];
 
-	uint8_t reboot_counter;
+	/* Pairing section */
 	uint8_t paired_addr[8];
 
+	/* Calibration section */
 	uint8_t sensor_data[128];
 
 	float accelBias[3];
@@ -58,22 +124,14 @@ struct retained_data {
 	float magBias[3];
 	float magBAinv[4][3];
 	float accBAinv[4][3];
-	float gyroSensScale[3]; // Gyro sensitivity
-
-	uint8_t fusion_id; // fusion_data_stored
-	uint8_t fusion_data[512];
+	float gyroSensScale[GYRO_SENS_RANGES][3]; // Gyro sensitivity, per gyro full scale
 
+	/* Scan section */
 	uint16_t imu_addr;
 	uint16_t mag_addr;
 
 	uint8_t imu_reg;
 	uint8_t mag_reg;
-
-	/* CRC used to validate the retained data.  This must be
-	 * stored little-endian, and covers everything up to but not
-	 * including this field.
-	 */
-	uint32_t crc;
 };
 
 /* Up to 1 KB of retained data allowed right now.
@@ -85,16 +143,30 @@ struct retained_data {
  */
 extern struct retained_data *retained;
 
-/* Check whether the retained data is valid, and if not reset it.
+/* Check whether each section of the retained data is valid, and reset
+ * the sections that are not.
  *
- * @return true if and only if the data was valid and reflects state
+ * @return true if and only if all sections were valid and reflect state
  * from previous sessions.
  */
 bool retained_validate(void);
 
-/* Update any generic retained state and recalculate its checksum so
+/* Whether a section was valid when the retained data was validated.
+ */
+bool retained_section_valid(enum retained_section section);
+
+/* Update any generic retained state and recalculate all checksums so
  * subsequent boots can verify the retained state.
  */
 void retained_update(void);
 
+/* Update generic retained state and recalculate only the checksum of
+ * the given section.
+ */
+void retained_update_section(enum retained_section section);
+
+/* Same as retained_update_section, for the section containing ptr.
+ */
+void retained_update_at(const void *ptr);
+
 #endif /* RETAINED_H_ */
\ No newline at end of file
@@ -261,87 +261,74 @@ void sensor_request_calibration_mag(void)
 		magneto_progress |= 1 << 6;
 }
 
-static float aBuf[3] = {0};
-uint64_t accel_sample = 0;
-uint64_t accel_wait_sample = 0;
+// The calibration thread requests a sample with a message queue, the sensor thread only posts samples while a request is pending
+K_MSGQ_DEFINE(accel_sample_msgq, sizeof(float[3]), 1, 4);
+K_MSGQ_DEFINE(gyro_sample_msgq, sizeof(float[3]), 1, 4);
+K_MSGQ_DEFINE(mag_sample_msgq, sizeof(float[3]), 1, 4);
+
+static float aBuf[3] = {0}; // last accel, used with magnetometer samples
+static atomic_t accel_wait_sample;
+static atomic_t gyro_wait_sample;
+static atomic_t mag_wait_sample;
+
+static void sensor_sample_post(struct k_msgq *msgq, atomic_t *wait, const float v[3])
+{
+	if (atomic_cas(wait, 1, 0)) // one sample per request
+		k_msgq_put(msgq, v, K_NO_WAIT);
+}
+
+static int sensor_sample_request(struct k_msgq *msgq, atomic_t *wait, float v[3], k_timeout_t timeout)
+{
+	k_msgq_purge(msgq); // only a sample after the request
+	atomic_set(wait, 1);
+	int err = k_msgq_get(msgq, v, timeout);
+	atomic_set(wait, 0);
+	return err;
+}
 
 static void sensor_sample_accel(const float a[3])
 {
 	memcpy(aBuf, a, sizeof(aBuf));
-	accel_sample++;
-	if (accel_wait_sample)
-		k_usleep(1); // yield to waiting thread
+	sensor_sample_post(&accel_sample_msgq, &accel_wait_sample, a);
 }
 
 static int sensor_wait_accel(float a[3], k_timeout_t timeout)
 {
-	int64_t sample_end_time = MAX(k_uptime_ticks() + timeout.ticks, timeout.ticks);
-	accel_wait_sample = accel_sample;
-	while (accel_sample <= accel_wait_sample && k_uptime_ticks() < sample_end_time)
-		k_usleep(1);
-	accel_wait_sample = 0;
-	if (k_uptime_ticks() >= sample_end_time)
+	if (sensor_sample_request(&accel_sample_msgq, &accel_wait_sample, a, timeout))
 	{
 		LOG_ERR("Accelerometer wait timed out");
 		return -1;
 	}
-	memcpy(a, aBuf, sizeof(aBuf));
 	return 0;
 }
 
-static float gBuf[3] = {0};
-uint64_t gyro_sample = 0;
-uint64_t gyro_wait_sample = 0;
-
 static void sensor_sample_gyro(const float g[3])
 {
-	memcpy(gBuf, g, sizeof(gBuf));
-	gyro_sample++;
-	if (gyro_wait_sample)
-		k_usleep(1); // yield to waiting thread
+	sensor_sample_post(&gyro_sample_msgq, &gyro_wait_sample, g);
 }
 
 static int sensor_wait_gyro(float g[3], k_timeout_t timeout)
 {
-	int64_t sample_end_time = MAX(k_uptime_ticks() + timeout.ticks, timeout.ticks);
-	gyro_wait_sample = gyro_sample;
-	while (gyro_sample <= gyro_wait_sample && k_uptime_ticks() < sample_end_time)
-		k_usleep(1);
-	gyro_wait_sample = 0;
-	if (k_uptime_ticks() >= sample_end_time)
+	if (sensor_sample_request(&gyro_sample_msgq, &gyro_wait_sample, g, timeout))
 	{
 		LOG_ERR("Gyroscope wait timed out");
 		return -1;
 	}
-	memcpy(g, gBuf, sizeof(gBuf));
 	return 0;
 }
 
-static float mBuf[3] = {0};
-uint64_t mag_sample = 0;
-uint64_t mag_wait_sample = 0;
-
 static void sensor_sample_mag(const float m[3])
 {
-	memcpy(mBuf, m, sizeof(mBuf));
-	mag_sample++;
-	if (mag_wait_sample)
-		k_usleep(1); // yield to waiting thread
+	sensor_sample_post(&mag_sample_msgq, &mag_wait_sample, m);
 }
 
 static int sensor_wait_mag(float m[3], k_timeout_t timeout)
 {
-	int64_t sample_end_time = MAX(k_uptime_ticks() + timeout.ticks, timeout.ticks);
-	mag_wait_sample = mag_sample;
-	while (mag_sample <= mag_wait_sample && k_uptime_ticks() < sample_end_time)
-		k_usleep(1);
-	mag_wait_sample = 0;
-	if (k_uptime_ticks() >= sample_end_time)
+	if (sensor_sample_request(&mag_sample_msgq, &mag_wait_sample, m, timeout))
 	{
 		LOG_ERR("Magnetometer wait timed out");
 		return -1;
 	}
-	memcpy(m, mBuf, sizeof(mBuf));
 	return 0;
 }
 
@@ -31,9 +31,11 @@ LOG_MODULE_REGISTER(sensorfusion, LOG_LEVEL_INF);
 
 void sensorfusion_init(float g_time, float a_time, float m_time) {}
 
-void sensorfusion_load(const void* data) {}
+void sensorfusion_update_rate(float g_time, float a_time, float m_time) {}
 
-void sensorfusion_save(void* data) {}
+void sensorfusion_load(const struct retained_fusion_state* data) {}
+
+void sensorfusion_save(struct retained_fusion_state* data) {}
 
 void sensorfusion_update_gyro(float* g, float time) {}
 
@@ -57,6 +59,7 @@ void sensorfusion_get_quat(float* q) {}
 
 const sensor_fusion_t sensor_fusion_motionsense
 	= {*sensorfusion_init,
+	   *sensorfusion_update_rate,
 	   *sensorfusion_load,
 	   *sensorfusion_save,
 
@@ -26,8 +26,9 @@
 #include "sensor/sensor.h"
 
 void sensorfusion_init(float g_time, float a_time, float m_time);
-void sensorfusion_load(const void* data);
-void sensorfusion_save(void* data);
+void sensorfusion_update_rate(float g_time, float a_time, float m_time);
+void sensorfusion_load(const struct retained_fusion_state* data);
+void sensorfusion_save(struct retained_fusion_state* data);
 
 void sensorfusion_update_gyro(float* g, float time);
 void sensorfusion_update_accel(float* a, float time);
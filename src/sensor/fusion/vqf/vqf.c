@@ -20,6 +20,8 @@
 	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 	THE SOFTWARE.
 */
+#include <zephyr/kernel.h>
+
 #include "globals.h"
 #include "util.h"
 
@@ -38,6 +40,8 @@ static vqf_params_t params;
 static vqf_state_t state;
 static vqf_coeffs_t coeffs;
 
+static vqf_state_t last_state; // scratch copy for update_rate, too large for the sensor thread stack
+
 static float last_a[3] = {0};
 
 void vqf_update_sensor_ids(int imu)
@@ -71,17 +75,37 @@ void vqf_init(float g_time, float a_time, float m_time)
 	initVqf(&params, &state, &coeffs, g_time, a_time, m_time);
 }
 
-void vqf_load(const void *data)
+void vqf_update_rate(float g_time, float a_time, float m_time)
 {
-	set_params();
-	memcpy(&state, data, sizeof(state));
-	memcpy(&coeffs, (uint8_t *)data + sizeof(state), sizeof(coeffs));
+	memcpy(&last_state, &state, sizeof(state));
+	initVqf(&params, &state, &coeffs, g_time, a_time, m_time); // coefficients depend on the sample time
+	memcpy(&state, &last_state, sizeof(state));
+}
+
+void vqf_load(const struct retained_fusion_state *data)
+{
+	// Coefficients are already set by init, only restore the state
+	memcpy(state.gyrQuat, data->q, sizeof(state.gyrQuat)); // full orientation is carried by the gyro quaternion
+	state.accQuat[0] = 1.0f;
+	state.accQuat[1] = 0.0f;
+	state.accQuat[2] = 0.0f;
+	state.accQuat[3] = 0.0f;
+	state.delta = 0.0f;
+	float bias_rad[3];
+	for (int i = 0; i < 3; i++)
+		bias_rad[i] = data->gyro_bias[i] * DEG_TO_RAD; // stored in deg/s
+	float sigma_rad = data->gyro_bias_sigma < 0 ? -1 : data->gyro_bias_sigma * DEG_TO_RAD;
+	setBiasEstimate(&state, bias_rad, sigma_rad); // also restores the bias covariance
+	state.restDetected = data->rest;
 }
 
-void vqf_save(void *data)
+void vqf_save(struct retained_fusion_state *data)
 {
-	memcpy(data, &state, sizeof(state));
-	memcpy((uint8_t *)data + sizeof(state), &coeffs, sizeof(coeffs));
+	getQuat9D(&state, data->q);
+	data->gyro_bias_sigma = getBiasEstimate(&state, &coeffs, data->gyro_bias) / DEG_TO_RAD;
+	for (int i = 0; i < 3; i++)
+		data->gyro_bias[i] /= DEG_TO_RAD; // rad/s to deg/s
+	data->rest = getRestDetected(&state);
 }
 
 void vqf_update_gyro(float *g, float time)
@@ -126,11 +150,16 @@ void vqf_update(float *g, float *a, float *m, float time)
 void vqf_get_gyro_bias(float *g_off)
 {
 	getBiasEstimate(&state, &coeffs, g_off);
+	for (int i = 0; i < 3; i++)
+		g_off[i] /= DEG_TO_RAD; // rad/s to deg/s, same unit as update_gyro
 }
 
 void vqf_set_gyro_bias(float *g_off)
 {
-	setBiasEstimate(&state, g_off, -1);
+	float g_off_rad[3];
+	for (int i = 0; i < 3; i++)
+		g_off_rad[i] = g_off[i] * DEG_TO_RAD;
+	setBiasEstimate(&state, g_off_rad, -1);
 }
 
 void vqf_update_gyro_sanity(float *g, float *m)
@@ -178,6 +207,7 @@ void vqf_get_relative_rest_deviations(float *out)
 
 const sensor_fusion_t sensor_fusion_vqf = {
 	*vqf_init,
+	*vqf_update_rate,
 	*vqf_load,
 	*vqf_save,
 
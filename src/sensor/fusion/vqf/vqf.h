@@ -28,8 +28,9 @@
 void vqf_update_sensor_ids(int imu);
 
 void vqf_init(float g_time, float a_time, float m_time);
-void vqf_load(const void *data);
-void vqf_save(void *data);
+void vqf_update_rate(float g_time, float a_time, float m_time);
+void vqf_load(const struct retained_fusion_state *data);
+void vqf_save(struct retained_fusion_state *data);
 
 void vqf_update_gyro(float *g, float time);
 void vqf_update_accel(float *a, float time);
@@ -51,14 +51,27 @@ void fusion_init(float g_time, float a_time, float m_time) {
 	FusionAhrsSetSettings(&ahrs, &settings);
 }
 
-void fusion_load(const void* data) {
-	memcpy(&ahrs, data, sizeof(ahrs));
-	memcpy(&offset, (uint8_t*)data + sizeof(ahrs), sizeof(offset));
+void fusion_update_rate(float g_time, float a_time, float m_time) {
+	// AHRS uses the time of each update, only the offset filter depends on the rate
+	FusionVector gyroscope_offset = offset.gyroscopeOffset;
+	unsigned int timer = offset.timer;
+	FusionOffsetInitialise2(&offset, 1.0f / g_time);
+	offset.gyroscopeOffset = gyroscope_offset;
+	offset.timer = MIN(timer, offset.timeout);
 }
 
-void fusion_save(void* data) {
-	memcpy(data, &ahrs, sizeof(ahrs));
-	memcpy((uint8_t*)data + sizeof(ahrs), &offset, sizeof(offset));
+void fusion_load(const struct retained_fusion_state* data) {
+	memcpy(ahrs.quaternion.array, data->q, sizeof(ahrs.quaternion.array));
+	ahrs.initialising = false;  // orientation is known, skip the startup ramp
+	ahrs.rampedGain = ahrs.settings.gain;
+	memcpy(offset.gyroscopeOffset.array, data->gyro_bias, sizeof(offset.gyroscopeOffset.array));
+}
+
+void fusion_save(struct retained_fusion_state* data) {
+	memcpy(data->q, ahrs.quaternion.array, sizeof(ahrs.quaternion.array));
+	memcpy(data->gyro_bias, offset.gyroscopeOffset.array, sizeof(offset.gyroscopeOffset.array));
+	data->gyro_bias_sigma = -1.0f;  // not estimated
+	data->rest = offset.timer >= offset.timeout;
 }
 
 void fusion_update_gyro(float* g, float time) {
@@ -179,6 +192,7 @@ void fusion_get_quat(float* q) {
 
 const sensor_fusion_t sensor_fusion_fusion
 	= {*fusion_init,
+	   *fusion_update_rate,
 	   *fusion_load,
 	   *fusion_save,
 
@@ -26,8 +26,9 @@
 #include "sensor/sensor.h"
 
 void fusion_init(float g_time, float a_time, float m_time);
-void fusion_load(const void* data);
-void fusion_save(void* data);
+void fusion_update_rate(float g_time, float a_time, float m_time);
+void fusion_load(const struct retained_fusion_state* data);
+void fusion_save(struct retained_fusion_state* data);
 
 void fusion_update_gyro(float* g, float time);
 void fusion_update_accel(float* a, float time);
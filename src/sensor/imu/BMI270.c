@@ -1,4 +1,5 @@
 #include <math.h>
+#include <string.h>
 
 #include <zephyr/logging/log.h>
 #include <hal/nrf_gpio.h>
@@ -9,6 +10,12 @@
 
 #define PACKET_SIZE 12
 
+#if CONFIG_SOC_NRF52832
+#define UPLOAD_BURST 128 // EasyDMA MAXCNT is 8 bits
+#else
+#define UPLOAD_BURST 1024 // must be a multiple of 32 (INIT_ADDR_0 is the lower 4 bits of the word address)
+#endif
+
 static float accel_sensitivity = 16.0f / 32768.0f; // default 16g
 static float gyro_sensitivity = 2000.0f / 32768.0f; // default 2000dps
 
@@ -107,6 +114,20 @@ void bmi_update_fs(float accel_range, float gyro_range, float *accel_actual_rang
 	*gyro_actual_range = gyro_range;
 }
 
+int bmi_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range)
+{
+	uint8_t last_accel_fs = accel_fs;
+	uint8_t last_gyro_fs = gyro_fs;
+	bmi_update_fs(accel_range, gyro_range, accel_actual_range, gyro_actual_range);
+	if (accel_fs == last_accel_fs && gyro_fs == last_gyro_fs)
+		return 1;
+	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, BMI270_ACC_RANGE, accel_fs);
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, BMI270_GYR_RANGE, gyro_fs);
+	if (err)
+		LOG_ERR("Communication error");
+	return (err < 0 ? err : 0);
+}
+
 int bmi_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time)
 {
 	int ODR;
@@ -433,20 +454,36 @@ static int asic_init(void)
 // saved my ass
 static int upload_config_file(void)
 {
+	int64_t start = k_uptime_ticks();
 	uint16_t count = sizeof(bmi270_config_file) / sizeof(bmi270_config_file[0]);
+	uint16_t burst = UPLOAD_BURST;
+	// EasyDMA cannot read from flash, copy each burst to RAM after the register address so it is sent in one transfer
+	uint8_t fallback_buf[1 + 64];
+	uint8_t *buf = (uint8_t *)k_malloc(1 + burst);
+	if (buf == NULL)
+	{
+		LOG_WRN("Failed to allocate memory for config upload");
+		buf = fallback_buf;
+		burst = 64;
+	}
 	uint8_t init_addr[2] = {0};
 	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, BMI270_INIT_CTRL, 0x00); // prepare config load
-	for (int i = 0; i < count; i += 64)
+	buf[0] = BMI270_INIT_DATA;
+	for (int i = 0; i < count; i += burst)
 	{
+		uint16_t len = MIN(burst, count - i);
 		init_addr[0] = (i / 2) & 0xF;
 		init_addr[1] = (i / 2) >> 4;
 		err |= ssi_burst_write(SENSOR_INTERFACE_DEV_IMU, BMI270_INIT_ADDR_0, init_addr, 2);
-		err |= ssi_burst_write(SENSOR_INTERFACE_DEV_IMU, BMI270_INIT_DATA, &bmi270_config_file[i], 64); // 64 works, 128 doesn't? either way it takes forever
+		memcpy(&buf[1], &bmi270_config_file[i], len);
+		err |= ssi_write(SENSOR_INTERFACE_DEV_IMU, buf, 1 + len);
 	}
+	if (buf != fallback_buf)
+		k_free(buf);
 	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, BMI270_INIT_CTRL, 0x01); // complete config load
 	if (err)
 		LOG_ERR("Communication error");
-	// LOG_DBG("Completed config load");
+	LOG_INF("Config upload took %lluus (%u byte bursts)", k_ticks_to_us_floor64(k_uptime_ticks() - start), burst);
 	return 0;
 }
 
@@ -553,6 +590,7 @@ const sensor_imu_t sensor_imu_bmi270 = {
 	*bmi_shutdown,
 
 	*bmi_update_fs,
+	*bmi_set_fs,
 	*bmi_update_odr,
 
 	*bmi_fifo_read,
@@ -564,5 +602,8 @@ const sensor_imu_t sensor_imu_bmi270 = {
 	*bmi_setup_WOM,
 	
 	*imu_none_ext_setup,
-	*imu_none_ext_passthrough
+	*imu_none_ext_passthrough,
+
+	*imu_none_ext_fifo_setup,
+	*imu_none_fifo_process_ext
 };
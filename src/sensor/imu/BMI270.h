@@ -77,6 +77,7 @@ int bmi_init(float clock_rate, float accel_time, float gyro_time, float *accel_a
 void bmi_shutdown(void);
 
 void bmi_update_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
+int bmi_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
 int bmi_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time);
 
 uint16_t bmi_fifo_read(uint8_t *data, uint16_t len);
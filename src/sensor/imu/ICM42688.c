@@ -35,6 +35,9 @@ static float clock_scale = 1; // ODR is scaled by clock_rate/clock_reference
 static float fifo_multiplier_factor = FIFO_MULT;
 static float fifo_multiplier = 0;
 
+static float fifo_temp; // temperature from the last FIFO packet
+static bool fifo_temp_valid;
+
 LOG_MODULE_REGISTER(ICM42688, LOG_LEVEL_DBG);
 
 int icm_init(float clock_rate, float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time)
@@ -44,6 +47,8 @@ int icm_init(float clock_rate, float accel_time, float gyro_time, float *accel_a
 		fifo_multiplier_factor = FIFO_MULT_SPI; // SPI mode
 	else
 		fifo_multiplier_factor = FIFO_MULT; // I2C mode
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, ICM42688_INTF_CONFIG0, ICM42688_INT_SOURCE1); // bank 0 configuration registers
+	ssi_reg_cache_bank(SENSOR_INTERFACE_DEV_IMU, ICM42688_REG_BANK_SEL);
 	int err = 0;
 //	ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_INT_SOURCE0, 0x00); // disable default interrupt (RESET_DONE)
 	if (clock_rate > 0)
@@ -74,6 +79,7 @@ void icm_shutdown(void)
 	last_accel_odr = 0xff; // reset last odr
 	last_gyro_odr = 0xff; // reset last odr
 	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_DEVICE_CONFIG, 0x01); // Don't need to wait for ICM to finish reset
+	ssi_reg_cache_invalidate(SENSOR_INTERFACE_DEV_IMU);
 	if (err)
 		LOG_ERR("Communication error");
 }
@@ -272,8 +278,11 @@ int icm_update_odr(float accel_time, float gyro_time, float *accel_actual_time,
 	last_accel_odr = AODR;
 	last_gyro_odr = GODR;
 
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_ACCEL_CONFIG0, Ascale << 5 | AODR); // set accel ODR and FS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_GYRO_CONFIG0, Gscale << 5 | GODR); // set gyro ODR and FS
+	const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(ICM42688_GYRO_CONFIG0, Gscale << 5 | GODR), // set gyro ODR and FS
+		SSI_SEQ_WRITE(ICM42688_ACCEL_CONFIG0, Ascale << 5 | AODR), // set accel ODR and FS
+	};
+	err |= ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 
@@ -357,6 +366,12 @@ int icm_fifo_process(uint16_t index, uint8_t *data, float a[3], float g[3])
 		a_raw[i] *= accel_sensitivity_32;
 		g_raw[i] *= gyro_sensitivity_32;
 	}
+	int16_t raw_temp = (int16_t)((((uint16_t)data[index + 13]) << 8) | data[index + 14]);
+	if (raw_temp != INT16_MIN && sensor_interface_imu_primary()) // valid temperature data, not from an additional IMU
+	{
+		fifo_temp = (float)raw_temp / 132.48f + 25;
+		fifo_temp_valid = true;
+	}
 	memcpy(a, a_raw, sizeof(a_raw));
 	memcpy(g, g_raw, sizeof(g_raw));
 	return 0;
@@ -390,6 +405,11 @@ void icm_gyro_read(float g[3])
 
 float icm_temp_read(void)
 {
+	if (fifo_temp_valid) // use the temperature from the FIFO if there was new data
+	{
+		fifo_temp_valid = false;
+		return fifo_temp;
+	}
 	uint8_t rawTemp[2];
 	int err = ssi_burst_read(SENSOR_INTERFACE_DEV_IMU, ICM42688_TEMP_DATA1, &rawTemp[0], 2);
 	if (err)
@@ -405,20 +425,20 @@ uint8_t icm_setup_WOM(void)
 {
 	uint8_t interrupts;
 	int err = ssi_reg_read_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_INT_STATUS, &interrupts); // clear reset done int flag
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_INT_SOURCE0, 0x00); // disable default interrupt (RESET_DONE)
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_ACCEL_CONFIG0, AFS_8G << 5 | AODR_200Hz); // set accel ODR and FS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_PWR_MGMT0, aMode_LP); // set accel and gyro modes
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_INTF_CONFIG1, 0x00); // set low power clock
-	k_msleep(1);
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_REG_BANK_SEL, 0x04); // select register bank 4
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_ACCEL_WOM_X_THR, 0x08); // set wake thresholds // 8 x 3.9 mg is ~31.25 mg
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_ACCEL_WOM_Y_THR, 0x08); // set wake thresholds
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_ACCEL_WOM_Z_THR, 0x08); // set wake thresholds
-	k_msleep(1);
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_REG_BANK_SEL, 0x00); // select register bank 0
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_INT_SOURCE1, 0x07); // enable WOM interrupt
-	k_msleep(50); // TODO: does this need to be 50ms?
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM42688_SMD_CONFIG, 0x01); // enable WOM feature
+	static const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(ICM42688_INT_SOURCE0, 0x00), // disable default interrupt (RESET_DONE)
+		SSI_SEQ_WRITE(ICM42688_ACCEL_CONFIG0, AFS_8G << 5 | AODR_200Hz), // set accel ODR and FS
+		SSI_SEQ_WRITE(ICM42688_PWR_MGMT0, aMode_LP), // set accel and gyro modes
+		SSI_SEQ_WRITE_DELAY(ICM42688_INTF_CONFIG1, 0x00, 1000), // set low power clock
+		SSI_SEQ_WRITE(ICM42688_REG_BANK_SEL, 0x04), // select register bank 4
+		SSI_SEQ_WRITE(ICM42688_ACCEL_WOM_X_THR, 0x08), // set wake thresholds // 8 x 3.9 mg is ~31.25 mg
+		SSI_SEQ_WRITE(ICM42688_ACCEL_WOM_Y_THR, 0x08), // set wake thresholds
+		SSI_SEQ_WRITE_DELAY(ICM42688_ACCEL_WOM_Z_THR, 0x08, 1000), // set wake thresholds
+		SSI_SEQ_WRITE(ICM42688_REG_BANK_SEL, 0x00), // select register bank 0
+		SSI_SEQ_WRITE_DELAY(ICM42688_INT_SOURCE1, 0x07, 50000), // enable WOM interrupt // TODO: does this need to be 50ms?
+		SSI_SEQ_WRITE(ICM42688_SMD_CONFIG, 0x01), // enable WOM feature
+	};
+	err |= ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 	return NRF_GPIO_PIN_PULLUP << 4 | NRF_GPIO_PIN_SENSE_LOW; // active low
@@ -429,6 +449,7 @@ const sensor_imu_t sensor_imu_icm42688 = {
 	*icm_shutdown,
 
 	*icm_update_fs,
+	*imu_none_set_fs, // FIFO hires packets are always full range
 	*icm_update_odr,
 
 	*icm_fifo_read,
@@ -440,5 +461,8 @@ const sensor_imu_t sensor_imu_icm42688 = {
 	*icm_setup_WOM,
 	
 	*imu_none_ext_setup,
-	*imu_none_ext_passthrough
+	*imu_none_ext_passthrough,
+
+	*imu_none_ext_fifo_setup,
+	*imu_none_fifo_process_ext
 };
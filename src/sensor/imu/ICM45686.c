@@ -25,6 +25,9 @@ static float clock_scale = 1; // ODR is scaled by clock_rate/clock_reference
 static float fifo_multiplier_factor = FIFO_MULT;
 static float fifo_multiplier = 0;
 
+static float fifo_temp; // temperature from the last FIFO packet
+static bool fifo_temp_valid;
+
 LOG_MODULE_REGISTER(ICM45686, LOG_LEVEL_DBG);
 
 int icm45_init(float clock_rate, float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time)
@@ -34,6 +37,13 @@ int icm45_init(float clock_rate, float accel_time, float gyro_time, float *accel
 		fifo_multiplier_factor = FIFO_MULT_SPI; // SPI mode
 	else
 		fifo_multiplier_factor = FIFO_MULT; // I2C mode
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, ICM45686_PWR_MGMT0, ICM45686_PWR_MGMT0);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, ICM45686_INT1_CONFIG0, ICM45686_INT1_CONFIG1);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, ICM45686_ACCEL_CONFIG0, ICM45686_FIFO_CONFIG0);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, ICM45686_FIFO_CONFIG3, ICM45686_FIFO_CONFIG3);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, ICM45686_TMST_WOM_CONFIG, ICM45686_TMST_WOM_CONFIG);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, ICM45686_RTC_CONFIG, ICM45686_RTC_CONFIG);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, ICM45686_IOC_PAD_SCENARIO_AUX_OVRD, ICM45686_IOC_PAD_SCENARIO_OVRD);
 	int err = 0;
 	if (clock_rate > 0)
 	{
@@ -64,6 +74,7 @@ void icm45_shutdown(void)
 	last_accel_odr = 0xff; // reset last odr
 	last_gyro_odr = 0xff; // reset last odr
 	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM45686_REG_MISC2, 0x02); // Don't need to wait for ICM to finish reset
+	ssi_reg_cache_invalidate(SENSOR_INTERFACE_DEV_IMU);
 	if (err)
 		LOG_ERR("Communication error");
 }
@@ -242,8 +253,11 @@ int icm45_update_odr(float accel_time, float gyro_time, float *accel_actual_time
 	last_accel_odr = ACCEL_ODR;
 	last_gyro_odr = GYRO_ODR;
 
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM45686_ACCEL_CONFIG0, ACCEL_UI_FS_SEL << 4 | ACCEL_ODR); // set accel ODR and FS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, ICM45686_GYRO_CONFIG0, GYRO_UI_FS_SEL << 4 | GYRO_ODR); // set gyro ODR and FS
+	const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(ICM45686_ACCEL_CONFIG0, ACCEL_UI_FS_SEL << 4 | ACCEL_ODR), // set accel ODR and FS
+		SSI_SEQ_WRITE(ICM45686_GYRO_CONFIG0, GYRO_UI_FS_SEL << 4 | GYRO_ODR), // set gyro ODR and FS
+	};
+	err |= ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 
@@ -325,6 +339,12 @@ int icm45_fifo_process(uint16_t index, uint8_t *data, float a[3], float g[3])
 		a_raw[i] *= accel_sensitivity_32;
 		g_raw[i] *= gyro_sensitivity_32;
 	}
+	int16_t raw_temp = (int16_t)((((uint16_t)data[index + 13]) << 8) | data[index + 14]);
+	if (raw_temp != INT16_MIN && sensor_interface_imu_primary()) // valid temperature data, not from an additional IMU
+	{
+		fifo_temp = (float)raw_temp / 128 + 25;
+		fifo_temp_valid = true;
+	}
 	memcpy(a, a_raw, sizeof(a_raw));
 	memcpy(g, g_raw, sizeof(g_raw));
 	return 0;
@@ -358,6 +378,11 @@ void icm45_gyro_read(float g[3])
 
 float icm45_temp_read(void)
 {
+	if (fifo_temp_valid) // use the temperature from the FIFO if there was new data
+	{
+		fifo_temp_valid = false;
+		return fifo_temp;
+	}
 	uint8_t rawTemp[2];
 	int err = ssi_burst_read(SENSOR_INTERFACE_DEV_IMU, ICM45686_TEMP_DATA1_UI, &rawTemp[0], 2);
 	if (err)
@@ -416,6 +441,7 @@ const sensor_imu_t sensor_imu_icm45686 = {
 	*icm45_shutdown,
 
 	*icm45_update_fs,
+	*imu_none_set_fs, // FIFO hires packets are always full range
 	*icm45_update_odr,
 
 	*icm45_fifo_read,
@@ -427,5 +453,8 @@ const sensor_imu_t sensor_imu_icm45686 = {
 	*icm45_setup_WOM,
 	
 	*imu_none_ext_setup,
-	*icm45_ext_passthrough
+	*icm45_ext_passthrough,
+
+	*imu_none_ext_fifo_setup,
+	*imu_none_fifo_process_ext
 };
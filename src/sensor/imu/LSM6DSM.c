@@ -21,6 +21,11 @@ int lsm6dsm_init(float clock_rate, float accel_time, float gyro_time, float *acc
 {
 	// setup interface for SPI
 	sensor_interface_spi_configure(SENSOR_INTERFACE_DEV_IMU, MHZ(10), 0);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_FIFO_CTRL1, LSM6DSM_FIFO_CTRL5);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL1, LSM6DSM_CTRL2); // CTRL3 has self-clearing bits
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL4, LSM6DSM_CTRL10);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_TAP_CFG, LSM6DSM_MD2_CFG);
+	ssi_reg_cache_bank(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_FUNC_CFG_ACCESS);
 	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL3, 0x74); // freeze register until done reading, increment register address during multi-byte access (BDU, IF_INC), INT H_LACTIVE active low, PP_OD open-drain
 	if (err)
 		LOG_ERR("Communication error");
@@ -83,6 +88,20 @@ void lsm6dsm_update_fs(float accel_range, float gyro_range, float *accel_actual_
 	*gyro_actual_range = gyro_range;
 }
 
+int lsm6dsm_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range)
+{
+	uint8_t last_accel_fs = accel_fs;
+	uint8_t last_gyro_fs = gyro_fs;
+	lsm6dsm_update_fs(accel_range, gyro_range, accel_actual_range, gyro_actual_range);
+	if (accel_fs == last_accel_fs && gyro_fs == last_gyro_fs)
+		return 1;
+	int err = ssi_reg_update_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL1, 0x0C, accel_fs); // set accel FS, keep ODR
+	err |= ssi_reg_update_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL2, 0x0C, gyro_fs); // set gyro FS, keep ODR
+	if (err)
+		LOG_ERR("Communication error");
+	return (err < 0 ? err : 0);
+}
+
 int lsm6dsm_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time)
 {
 	int ODR;
@@ -268,15 +287,16 @@ int lsm6dsm_update_odr(float accel_time, float gyro_time, float *accel_actual_ti
 		fifo_pattern_length = gyro_time == 0 ? 1 : accel_time / gyro_time + 0.5f;
 	}
 
-	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL1, ODR_XL | accel_fs); // set accel ODR and FS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL6, OP_MODE_XL); // set accelerator perf mode
-
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL2, ODR_G | gyro_fs); // set gyro ODR and mode
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL7, OP_MODE_G); // set gyroscope perf mode
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL4, GYRO_SLEEP); // set gyroscope awake/sleep mode
-
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_FIFO_CTRL3, (DEC_G << 3) | DEC_XL); // set decimation
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_FIFO_CTRL5, (ODR_FIFO >> 1) | 0x06); // set FIFO ODR, FIFO Continuous mode
+	const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(LSM6DSM_CTRL1, ODR_XL | accel_fs), // set accel ODR and FS
+		SSI_SEQ_WRITE(LSM6DSM_CTRL2, ODR_G | gyro_fs), // set gyro ODR and mode
+		SSI_SEQ_WRITE(LSM6DSM_CTRL4, GYRO_SLEEP), // set gyroscope awake/sleep mode
+		SSI_SEQ_WRITE(LSM6DSM_CTRL6, OP_MODE_XL), // set accelerator perf mode
+		SSI_SEQ_WRITE(LSM6DSM_CTRL7, OP_MODE_G), // set gyroscope perf mode
+		SSI_SEQ_WRITE(LSM6DSM_FIFO_CTRL3, (DEC_G << 3) | DEC_XL), // set decimation
+		SSI_SEQ_WRITE(LSM6DSM_FIFO_CTRL5, (ODR_FIFO >> 1) | 0x06), // set FIFO ODR, FIFO Continuous mode
+	};
+	int err = ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 
@@ -357,16 +377,17 @@ uint8_t lsm6dsm_setup_WOM(void) // TODO:
 //	ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL1, ODR_OFF); // set accel off
 //	ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL2, ODR_OFF); // set gyro off
 
-	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL1, DSM_ODR_208Hz | DSM_FS_XL_8G); // set accel ODR and FS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL6, DSM_OP_MODE_XL_NP); // set accel perf mode
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL8, 0x74); // set HPCF_XL to the lowest bandwidth, enable HP_REF_MODE (set HP_REF_MODE, HP_SLOPE_XL_EN, HPCF_XL nonzero)
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_TAP_CFG, 0x10); // set SLOPE_FDS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_WAKE_UP_THS, 0x01); // set threshold, 1 * 31.25 mg is ~31.25 mg
-	k_msleep(12); // need to wait for accel to settle
-
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_TAP_CFG, 0x90); // enable interrupts (keep SLOPE_FDS)
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_MD1_CFG, 0x20); // route wake-up to INT1
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSM_CTRL3, 0x30); // INT H_LACTIVE active low, PP_OD open-drain
+	static const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(LSM6DSM_CTRL1, DSM_ODR_208Hz | DSM_FS_XL_8G), // set accel ODR and FS
+		SSI_SEQ_WRITE(LSM6DSM_CTRL6, DSM_OP_MODE_XL_NP), // set accel perf mode
+		SSI_SEQ_WRITE(LSM6DSM_CTRL8, 0x74), // set HPCF_XL to the lowest bandwidth, enable HP_REF_MODE (set HP_REF_MODE, HP_SLOPE_XL_EN, HPCF_XL nonzero)
+		SSI_SEQ_WRITE(LSM6DSM_TAP_CFG, 0x10), // set SLOPE_FDS
+		SSI_SEQ_WRITE_DELAY(LSM6DSM_WAKE_UP_THS, 0x01, 12000), // set threshold, 1 * 31.25 mg is ~31.25 mg, need to wait for accel to settle
+		SSI_SEQ_WRITE(LSM6DSM_TAP_CFG, 0x90), // enable interrupts (keep SLOPE_FDS)
+		SSI_SEQ_WRITE(LSM6DSM_MD1_CFG, 0x20), // route wake-up to INT1
+		SSI_SEQ_WRITE(LSM6DSM_CTRL3, 0x30), // INT H_LACTIVE active low, PP_OD open-drain
+	};
+	int err = ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 	return NRF_GPIO_PIN_PULLUP << 4 | NRF_GPIO_PIN_SENSE_LOW; // active low
@@ -377,6 +398,7 @@ const sensor_imu_t sensor_imu_lsm6dsm = {
 	*lsm_shutdown,
 
 	*lsm6dsm_update_fs,
+	*lsm6dsm_set_fs,
 	*lsm6dsm_update_odr,
 
 	*lsm6dsm_fifo_read,
@@ -388,5 +410,8 @@ const sensor_imu_t sensor_imu_lsm6dsm = {
 	*lsm6dsm_setup_WOM,
 	
 	*imu_none_ext_setup,
-	*lsm_ext_passthrough
+	*lsm_ext_passthrough,
+
+	*imu_none_ext_fifo_setup,
+	*imu_none_fifo_process_ext
 };
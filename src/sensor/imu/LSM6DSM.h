@@ -4,6 +4,9 @@
 #include "sensor/sensor.h"
 
 // https://www.st.com/resource/en/datasheet/lsm6dsm.pdf
+#define LSM6DSM_FUNC_CFG_ACCESS            0x01
+
+#define LSM6DSM_FIFO_CTRL1                 0x06
 #define LSM6DSM_FIFO_CTRL3                 0x08
 #define LSM6DSM_FIFO_CTRL5                 0x0A
 
@@ -14,6 +17,7 @@
 #define LSM6DSM_CTRL6                      0x15
 #define LSM6DSM_CTRL7                      0x16
 #define LSM6DSM_CTRL8                      0x17
+#define LSM6DSM_CTRL10                     0x19
 
 #define LSM6DSM_FIFO_STATUS1               0x3A
 #define LSM6DSM_FIFO_STATUS3               0x3C
@@ -23,6 +27,7 @@
 #define LSM6DSM_TAP_CFG                    0x58
 #define LSM6DSM_WAKE_UP_THS                0x5B
 #define LSM6DSM_MD1_CFG                    0x5E
+#define LSM6DSM_MD2_CFG                    0x5F
 
 #define DSM_FS_G_250DPS  0x00 //0bxxxx0000
 #define DSM_FS_G_500DPS  0x04 //0bxxxx0100
@@ -59,6 +64,7 @@
 int lsm6dsm_init(float clock_rate, float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time);
 
 void lsm6dsm_update_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
+int lsm6dsm_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
 int lsm6dsm_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time);
 
 uint16_t lsm6dsm_fifo_read(uint8_t *data, uint16_t len);
@@ -20,6 +20,11 @@ int lsm6dso_init(float clock_rate, float accel_time, float gyro_time, float *acc
 {
 	// setup interface for SPI
 	sensor_interface_spi_configure(SENSOR_INTERFACE_DEV_IMU, MHZ(10), 0);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FIFO_CTRL1, LSM6DSO_FIFO_CTRL4);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL1, LSM6DSO_CTRL2); // CTRL3 has self-clearing bits
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL4, LSM6DSO_CTRL10);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_TAP_CFG0, LSM6DSO_MD2_CFG);
+	ssi_reg_cache_bank(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS);
 	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL3, 0x74); // freeze register until done reading, increment register address during multi-byte access (BDU, IF_INC), INT H_LACTIVE active low, PP_OD open-drain
 	if (err)
 		LOG_ERR("Communication error");
@@ -29,7 +34,7 @@ int lsm6dso_init(float clock_rate, float accel_time, float gyro_time, float *acc
 	err |= ssi_reg_read_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_INTERNAL_FREQ_FINE, &internal_freq_fine); // affects ODR
 	freq_scale = 1.0f + 0.0015f * (float)internal_freq_fine;
 	err |= lsm6dso_update_odr(accel_time, gyro_time, accel_actual_time, gyro_actual_time);
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FIFO_CTRL4, 0x06); // enable Continuous mode
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FIFO_CTRL4, 0x26); // enable Continuous mode, batch temperature at 12.5Hz
 	if (err)
 		LOG_ERR("Communication error");
 	return (err < 0 ? err : 0);
@@ -86,6 +91,20 @@ void lsm6dso_update_fs(float accel_range, float gyro_range, float *accel_actual_
 	*gyro_actual_range = gyro_range;
 }
 
+int lsm6dso_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range)
+{
+	uint8_t last_accel_fs = accel_fs;
+	uint8_t last_gyro_fs = gyro_fs;
+	lsm6dso_update_fs(accel_range, gyro_range, accel_actual_range, gyro_actual_range);
+	if (accel_fs == last_accel_fs && gyro_fs == last_gyro_fs)
+		return 1;
+	int err = ssi_reg_update_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL1, 0x0C, accel_fs); // set accel FS, keep ODR
+	err |= ssi_reg_update_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL2, 0x0C, gyro_fs); // set gyro FS, keep ODR
+	if (err)
+		LOG_ERR("Communication error");
+	return (err < 0 ? err : 0);
+}
+
 int lsm6dso_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time)
 {
 	int ODR;
@@ -255,14 +274,15 @@ int lsm6dso_update_odr(float accel_time, float gyro_time, float *accel_actual_ti
 	last_accel_odr = ODR_XL;
 	last_gyro_odr = ODR_G;
 
-	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL1, ODR_XL | accel_fs); // set accel ODR and FS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL6, OP_MODE_XL); // set accelerator perf mode
-
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL2, ODR_G | gyro_fs); // set gyro ODR and mode
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL7, OP_MODE_G); // set gyroscope perf mode
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL4, GYRO_SLEEP); // set gyroscope awake/sleep mode
-
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FIFO_CTRL3, (ODR_XL >> 4) | ODR_G); // set accel and gyro batch rate
+	const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(LSM6DSO_CTRL1, ODR_XL | accel_fs), // set accel ODR and FS
+		SSI_SEQ_WRITE(LSM6DSO_CTRL2, ODR_G | gyro_fs), // set gyro ODR and mode
+		SSI_SEQ_WRITE(LSM6DSO_CTRL4, GYRO_SLEEP), // set gyroscope awake/sleep mode
+		SSI_SEQ_WRITE(LSM6DSO_CTRL6, OP_MODE_XL), // set accelerator perf mode
+		SSI_SEQ_WRITE(LSM6DSO_CTRL7, OP_MODE_G), // set gyroscope perf mode
+		SSI_SEQ_WRITE(LSM6DSO_FIFO_CTRL3, (ODR_XL >> 4) | ODR_G), // set accel and gyro batch rate
+	};
+	int err = ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 
@@ -304,17 +324,18 @@ uint8_t lsm6dso_setup_WOM(void)
 //	ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL1, ODR_OFF); // set accel off
 //	ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL2, ODR_OFF); // set gyro off
 
-	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL1, DSO_ODR_208Hz | DSO_FS_XL_8G); // set accel ODR and FS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL6, DSO_OP_MODE_XL_NP); // set accel perf mode
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL5, 0x80); // enable accel ULP // TODO: for LSM6DSR/ISM330DHCX this bit may be required to be 0
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL8, 0xF4); // set HPCF_XL to the lowest bandwidth, enable HP_REF_MODE (set HP_REF_MODE_XL, HP_SLOPE_XL_EN, HPCF_XL nonzero)
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_TAP_CFG0, 0x10); // set SLOPE_FDS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_WAKE_UP_THS, 0x01); // set threshold, 1 * 31.25 mg is ~31.25 mg
-	k_msleep(12); // need to wait for accel to settle
-
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_TAP_CFG2, 0x80); // enable interrupts
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_MD1_CFG, 0x20); // route wake-up to INT1
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_CTRL3, 0x30); // INT H_LACTIVE active low, PP_OD open-drain
+	static const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(LSM6DSO_CTRL1, DSO_ODR_208Hz | DSO_FS_XL_8G), // set accel ODR and FS
+		SSI_SEQ_WRITE(LSM6DSO_CTRL6, DSO_OP_MODE_XL_NP), // set accel perf mode (XL_HM_MODE before ULP_EN)
+		SSI_SEQ_WRITE(LSM6DSO_CTRL5, 0x80), // enable accel ULP // TODO: for LSM6DSR/ISM330DHCX this bit may be required to be 0
+		SSI_SEQ_WRITE(LSM6DSO_CTRL8, 0xF4), // set HPCF_XL to the lowest bandwidth, enable HP_REF_MODE (set HP_REF_MODE_XL, HP_SLOPE_XL_EN, HPCF_XL nonzero)
+		SSI_SEQ_WRITE(LSM6DSO_TAP_CFG0, 0x10), // set SLOPE_FDS
+		SSI_SEQ_WRITE_DELAY(LSM6DSO_WAKE_UP_THS, 0x01, 12000), // set threshold, 1 * 31.25 mg is ~31.25 mg, need to wait for accel to settle
+		SSI_SEQ_WRITE(LSM6DSO_TAP_CFG2, 0x80), // enable interrupts
+		SSI_SEQ_WRITE(LSM6DSO_MD1_CFG, 0x20), // route wake-up to INT1
+		SSI_SEQ_WRITE(LSM6DSO_CTRL3, 0x30), // INT H_LACTIVE active low, PP_OD open-drain
+	};
+	int err = ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 	return NRF_GPIO_PIN_PULLUP << 4 | NRF_GPIO_PIN_SENSE_LOW; // active low
@@ -331,15 +352,15 @@ int lsm6dso_ext_passthrough(bool passthrough)
 	int err = 0;
 	if (passthrough)
 	{
-		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
+		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
 		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_MASTER_CONFIG, 0x10); // passthrough on
-		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
+		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
 	}
 	else
 	{
-		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
+		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
 		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_MASTER_CONFIG, 0x08); // passthrough off
-		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
+		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
 	}
 	if (err)
 		LOG_ERR("Communication error");
@@ -354,7 +375,7 @@ int lsm6dso_ext_write(const uint8_t addr, const uint8_t *buf, uint32_t num_bytes
 		return -1;
 	}
 	// Configure transaction and begin one-shot (AN5922, page 80, One-shot write routine)
-	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
+	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
 	uint8_t slv0[3] = {(addr << 1) | 0x00, buf[0], 0x00 | 0x00}; // write, SHUB_ODR = 104Hz, reading no bytes
 	err |= ssi_burst_write(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_SLV0_ADD, slv0, 3);
 //	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_SLV0_ADD, (addr << 1) | 0x00); // write
@@ -369,7 +390,7 @@ int lsm6dso_ext_write(const uint8_t addr, const uint8_t *buf, uint32_t num_bytes
 		err |= ssi_reg_read_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_STATUS_MASTER, &status);
 	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_MASTER_CONFIG, 0x08); // SHUB_PU_EN, disable I2C master
 	k_usleep(300);
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
 	if (~status & 0x80)
 	{
 		LOG_ERR("Write timeout");
@@ -386,7 +407,7 @@ int lsm6dso_ext_write_read(const uint8_t addr, const void *write_buf, size_t num
 		return -1;
 	}
 	// Configure transaction and begin one-shot (AN5922, page 79, One-shot read routine)
-	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
+	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
 	uint8_t slv0[3] = {(addr << 1) | 0x01, ((const uint8_t *)write_buf)[0], 0x00 | num_read}; // read, SHUB_ODR = 104Hz, reading num_read bytes
 	err |= ssi_burst_write(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_SLV0_ADD, slv0, 3);
 //	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_SLV0_ADD, (addr << 1) | 0x01); // read
@@ -394,7 +415,7 @@ int lsm6dso_ext_write_read(const uint8_t addr, const void *write_buf, size_t num
 //	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_SLV0_CONFIG, 0x00 | num_read); // SHUB_ODR = 104Hz, reading num_read bytes
 	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_MASTER_CONFIG, 0x4C); // WRITE_ONCE mandatory for read, SHUB_PU_EN, enable I2C master
 	// Wait for transaction
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
 	uint8_t tmp;
 	err |= ssi_reg_read_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_OUTX_H_A, &tmp); // clear XLDA
 	uint8_t status = 0;
@@ -406,11 +427,11 @@ int lsm6dso_ext_write_read(const uint8_t addr, const void *write_buf, size_t num
 	while ((status & 0x01) && k_uptime_get() < timeout) // SENS_HUB_ENDOP
 		err |= ssi_reg_read_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_STATUS_MASTER_MAINPAGE, &status);
 	// Read data
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
 	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_MASTER_CONFIG, 0x08); // SHUB_PU_EN, disable I2C master
 	k_usleep(300);
 	err |= ssi_burst_read(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_SENSOR_HUB_1, read_buf, num_read);
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSO_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
 	return err;
 }
 
@@ -419,6 +440,7 @@ const sensor_imu_t sensor_imu_lsm6dso = {
 	*lsm_shutdown,
 
 	*lsm6dso_update_fs,
+	*lsm6dso_set_fs,
 	*lsm6dso_update_odr,
 
 	*lsm6dso_fifo_read,
@@ -430,7 +452,10 @@ const sensor_imu_t sensor_imu_lsm6dso = {
 	*lsm6dso_setup_WOM,
 	
 	*lsm6dso_ext_passthrough,
-	*lsm_ext_passthrough
+	*lsm_ext_passthrough,
+
+	*imu_none_ext_fifo_setup,
+	*imu_none_fifo_process_ext
 };
 
 const sensor_ext_ssi_t sensor_ext_lsm6dso = {
@@ -4,6 +4,9 @@
 #include "sensor/sensor.h"
 
 // https://www.st.com/resource/en/datasheet/lsm6dso.pdf
+#define LSM6DSO_FUNC_CFG_ACCESS            0x01
+
+#define LSM6DSO_FIFO_CTRL1                 0x07
 #define LSM6DSO_FIFO_CTRL3                 0x09
 #define LSM6DSO_FIFO_CTRL4                 0x0A
 
@@ -15,6 +18,7 @@
 #define LSM6DSO_CTRL6                      0x15
 #define LSM6DSO_CTRL7                      0x16
 #define LSM6DSO_CTRL8                      0x17
+#define LSM6DSO_CTRL10                     0x19
 
 #define LSM6DSO_STATUS_MASTER_MAINPAGE     0x39
 #define LSM6DSO_FIFO_STATUS1               0x3A
@@ -23,6 +27,7 @@
 #define LSM6DSO_TAP_CFG2                   0x58
 #define LSM6DSO_WAKE_UP_THS                0x5B
 #define LSM6DSO_MD1_CFG                    0x5E
+#define LSM6DSO_MD2_CFG                    0x5F
 
 #define LSM6DSO_INTERNAL_FREQ_FINE         0x63
 
@@ -63,6 +68,7 @@
 int lsm6dso_init(float clock_rate, float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time);
 
 void lsm6dso_update_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
+int lsm6dso_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
 int lsm6dso_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time);
 
 uint16_t lsm6dso_fifo_read(uint8_t *data, uint16_t len);
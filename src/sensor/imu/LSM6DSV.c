@@ -1,4 +1,5 @@
 #include <math.h>
+#include <string.h>
 
 #include <zephyr/logging/log.h>
 #include <hal/nrf_gpio.h>
@@ -23,12 +24,21 @@ uint8_t last_gyro_odr = 0xff;
 
 static float freq_scale = 1; // ODR is scaled by INTERNAL_FREQ_FINE
 
+static float fifo_temp; // temperature from the last FIFO packet
+static bool fifo_temp_valid;
+
 LOG_MODULE_REGISTER(LSM6DSV, LOG_LEVEL_DBG);
 
 int lsm_init(float clock_rate, float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time)
 {
 	// setup interface for SPI
 	sensor_interface_spi_configure(SENSOR_INTERFACE_DEV_IMU, MHZ(10), 0);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_IF_CFG, LSM6DSV_IF_CFG);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FIFO_CTRL1, LSM6DSV_FIFO_CTRL4);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL1, LSM6DSV_CTRL2); // CTRL3 has self-clearing bits
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL4, LSM6DSV_CTRL10);
+	ssi_reg_cache_enable(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNCTIONS_ENABLE, LSM6DSV_MD2_CFG);
+	ssi_reg_cache_bank(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS);
 	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL6, gyro_fs); // set gyro FS
 	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL8, accel_fs); // set accel FS
 	if (err)
@@ -40,7 +50,7 @@ int lsm_init(float clock_rate, float accel_time, float gyro_time, float *accel_a
 	err |= ssi_reg_read_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_INTERNAL_FREQ_FINE, &internal_freq_fine); // affects ODR
 	freq_scale = 1.0f + 0.0013f * (float)internal_freq_fine;
 	err |= lsm_update_odr(accel_time, gyro_time, accel_actual_time, gyro_actual_time);
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FIFO_CTRL4, 0x06); // enable Continuous mode
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FIFO_CTRL4, 0x26); // enable Continuous mode, batch temperature at 15Hz
 	if (err)
 		LOG_ERR("Communication error");
 	return (err < 0 ? err : 0);
@@ -51,6 +61,7 @@ void lsm_shutdown(void)
 	last_accel_odr = 0xff; // reset last odr
 	last_gyro_odr = 0xff; // reset last odr
 	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL3, 0x01); // SW_RESET
+	ssi_reg_cache_invalidate(SENSOR_INTERFACE_DEV_IMU);
 	if (err)
 		LOG_ERR("Communication error");
 }
@@ -116,6 +127,20 @@ void lsm_update_fs(float accel_range, float gyro_range, float *accel_actual_rang
 	*gyro_actual_range = gyro_range;
 }
 
+int lsm_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range)
+{
+	uint8_t last_accel_fs = accel_fs;
+	uint8_t last_gyro_fs = gyro_fs;
+	lsm_update_fs(accel_range, gyro_range, accel_actual_range, gyro_actual_range);
+	if (accel_fs == last_accel_fs && gyro_fs == last_gyro_fs)
+		return 1;
+	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL6, gyro_fs); // set gyro FS
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL8, accel_fs); // set accel FS
+	if (err)
+		LOG_ERR("Communication error");
+	return (err < 0 ? err : 0);
+}
+
 int lsm_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time)
 {
 	int ODR;
@@ -299,10 +324,12 @@ int lsm_update_odr(float accel_time, float gyro_time, float *accel_actual_time,
 	last_accel_odr = ODR_XL;
 	last_gyro_odr = ODR_G;
 
-	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL1, OP_MODE_XL << 4 | ODR_XL); // set accel ODR and mode
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL2, OP_MODE_G << 4 | ODR_G); // set gyro ODR and mode
-
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FIFO_CTRL3, ODR_XL | (ODR_G << 4)); // set accel and gyro batch rate
+	const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(LSM6DSV_CTRL1, OP_MODE_XL << 4 | ODR_XL), // set accel ODR and mode
+		SSI_SEQ_WRITE(LSM6DSV_CTRL2, OP_MODE_G << 4 | ODR_G), // set gyro ODR and mode
+		SSI_SEQ_WRITE(LSM6DSV_FIFO_CTRL3, ODR_XL | (ODR_G << 4)), // set accel and gyro batch rate
+	};
+	int err = ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 
@@ -360,6 +387,15 @@ int lsm_fifo_process(uint16_t index, uint8_t *data, float a[3], float g[3])
 		}
 		return 0;
 	}
+	if ((data[index] >> 3) == 0x03) // Temperature
+	{
+		if (!sensor_interface_imu_primary()) // from an additional IMU
+			return 1;
+		fifo_temp = (int16_t)((((uint16_t)data[index + 2]) << 8) | data[index + 1]);
+		fifo_temp = fifo_temp / 256 + 25;
+		fifo_temp_valid = true;
+		return 1; // no accel or gyro data
+	}
 	// TODO: need to skip invalid data
 	return 1;
 }
@@ -393,6 +429,11 @@ void lsm_gyro_read(float g[3])
 
 float lsm_temp_read(void)
 {
+	if (fifo_temp_valid) // use the temperature from the FIFO if there was new data
+	{
+		fifo_temp_valid = false;
+		return fifo_temp;
+	}
 	uint8_t rawTemp[2];
 	int err = ssi_burst_read(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_OUT_TEMP_L, &rawTemp[0], 2);
 	if (err)
@@ -410,16 +451,17 @@ uint8_t lsm_setup_WOM(void)
 //	ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL1, ODR_OFF); // set accel off
 //	ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL2, ODR_OFF); // set gyro off
 
-	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL8, 0xE0 | FS_XL_8G); // set accel FS, set HP_LPF2_XL_BW to lowest bandwidth, enable HP_REF_MODE (set HP_LPF2_XL_BW)
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL1, OP_MODE_XL_LP1 << 4 | ODR_240Hz); // set accel low power mode 1, set accel ODR (enable accel)
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_CTRL9, 0x50); // enable HP_REF_MODE (set HP_REF_MODE_XL and HP_SLOPE_XL_EN)
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_TAP_CFG0, 0x10); // set SLOPE_FDS
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_WAKE_UP_THS, 0x04); // set threshold, 4 * 7.8125 mg is ~31.25 mg
-	k_msleep(11); // need to wait for accel to settle
-
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNCTIONS_ENABLE, 0x80); // enable interrupts
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_MD1_CFG, 0x20); // route wake-up to INT1
-	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_IF_CFG, 0x18); // INT H_LACTIVE active low, PP_OD open-drain
+	static const ssi_reg_seq_t seq[] = {
+		SSI_SEQ_WRITE(LSM6DSV_CTRL8, 0xE0 | FS_XL_8G), // set accel FS, set HP_LPF2_XL_BW to lowest bandwidth, enable HP_REF_MODE (set HP_LPF2_XL_BW)
+		SSI_SEQ_WRITE(LSM6DSV_CTRL1, OP_MODE_XL_LP1 << 4 | ODR_240Hz), // set accel low power mode 1, set accel ODR (enable accel before HP_REF_MODE)
+		SSI_SEQ_WRITE(LSM6DSV_CTRL9, 0x50), // enable HP_REF_MODE (set HP_REF_MODE_XL and HP_SLOPE_XL_EN)
+		SSI_SEQ_WRITE(LSM6DSV_TAP_CFG0, 0x10), // set SLOPE_FDS
+		SSI_SEQ_WRITE_DELAY(LSM6DSV_WAKE_UP_THS, 0x04, 11000), // set threshold, 4 * 7.8125 mg is ~31.25 mg, need to wait for accel to settle
+		SSI_SEQ_WRITE(LSM6DSV_FUNCTIONS_ENABLE, 0x80), // enable interrupts
+		SSI_SEQ_WRITE(LSM6DSV_MD1_CFG, 0x20), // route wake-up to INT1
+		SSI_SEQ_WRITE(LSM6DSV_IF_CFG, 0x18), // INT H_LACTIVE active low, PP_OD open-drain
+	};
+	int err = ssi_reg_write_seq(SENSOR_INTERFACE_DEV_IMU, seq, ARRAY_SIZE(seq));
 	if (err)
 		LOG_ERR("Communication error");
 	return NRF_GPIO_PIN_PULLUP << 4 | NRF_GPIO_PIN_SENSE_LOW; // active low
@@ -455,6 +497,74 @@ int lsm_ext_passthrough(bool passthrough)
 	return 0;
 }
 
+int lsm_ext_fifo_setup(uint8_t addr, uint8_t reg, uint8_t len, float time, float *actual_time)
+{
+	if (len > 6) // FIFO only stores 6 bytes for each sensor
+		return -1;
+	uint8_t SHUB_ODR;
+	float ODR = time > 0 ? 1 / time : 0;
+	if (ODR > 240)
+	{
+		SHUB_ODR = 0x06; // 480Hz
+		time = 1.0 / 480;
+	}
+	else if (ODR > 120)
+	{
+		SHUB_ODR = 0x05; // 240Hz
+		time = 1.0 / 240;
+	}
+	else if (ODR > 60)
+	{
+		SHUB_ODR = 0x04; // 120Hz
+		time = 1.0 / 120;
+	}
+	else if (ODR > 30)
+	{
+		SHUB_ODR = 0x03; // 60Hz
+		time = 1.0 / 60;
+	}
+	else if (ODR > 15)
+	{
+		SHUB_ODR = 0x02; // 30Hz
+		time = 1.0 / 30;
+	}
+	else
+	{
+		SHUB_ODR = 0x01; // 15Hz
+		time = 1.0 / 15;
+	}
+	time /= freq_scale; // sensor hub is triggered by accel/gyro data ready
+	// Configure continuous read from slave 0 (AN5922, page 77, Sensor hub mode)
+	int err = ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x40); // switch to sensor hub registers
+	if (len)
+	{
+		uint8_t slv0[3] = {(addr << 1) | 0x01, reg, SHUB_ODR << 5 | 0x08 | len}; // read, SHUB_ODR, BATCH_EXT_SENS_0_EN, reading len bytes
+		err |= ssi_burst_write(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_SLV0_ADD, slv0, 3);
+		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_MASTER_CONFIG, 0x04); // enable I2C master, one slave
+	}
+	else
+	{
+		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_MASTER_CONFIG, 0x00); // disable I2C master
+		err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_SLV0_CONFIG, 0x00); // stop batching
+	}
+	err |= ssi_reg_write_byte(SENSOR_INTERFACE_DEV_IMU, LSM6DSV_FUNC_CFG_ACCESS, 0x00); // switch to normal registers
+	if (err)
+		LOG_ERR("Communication error");
+	*actual_time = len ? time : 0;
+	return (err < 0 ? -1 : 0);
+}
+
+int lsm_fifo_process_ext(uint16_t index, uint8_t *data, uint8_t *raw_ext)
+{
+	index *= PACKET_SIZE;
+	if ((data[index] >> 3) == 0x0E) // SensorHub slave 0
+	{
+		memcpy(raw_ext, &data[index + 1], 6);
+		return 0;
+	}
+	return 1;
+}
+
 int lsm_ext_write(const uint8_t addr, const uint8_t *buf, uint32_t num_bytes)
 {
 	if (num_bytes != 2)
@@ -528,6 +638,7 @@ const sensor_imu_t sensor_imu_lsm6dsv = {
 	*lsm_shutdown,
 
 	*lsm_update_fs,
+	*lsm_set_fs,
 	*lsm_update_odr,
 
 	*lsm_fifo_read,
@@ -539,7 +650,10 @@ const sensor_imu_t sensor_imu_lsm6dsv = {
 	*lsm_setup_WOM,
 	
 	*lsm_ext_setup,
-	*lsm_ext_passthrough
+	*lsm_ext_passthrough,
+
+	*lsm_ext_fifo_setup,
+	*lsm_fifo_process_ext
 };
 
 const sensor_ext_ssi_t sensor_ext_lsm6dsv = {
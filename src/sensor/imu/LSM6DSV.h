@@ -6,15 +6,18 @@
 // https://www.st.com/resource/en/datasheet/lsm6dsv.pdf
 #define LSM6DSV_IF_CFG                     0x03
 
+#define LSM6DSV_FIFO_CTRL1                 0x07
 #define LSM6DSV_FIFO_CTRL3                 0x09
 #define LSM6DSV_FIFO_CTRL4                 0x0A
 
 #define LSM6DSV_CTRL1                      0x10
 #define LSM6DSV_CTRL2                      0x11
 #define LSM6DSV_CTRL3                      0x12
+#define LSM6DSV_CTRL4                      0x13
 #define LSM6DSV_CTRL6                      0x15
 #define LSM6DSV_CTRL8                      0x17
 #define LSM6DSV_CTRL9                      0x18
+#define LSM6DSV_CTRL10                     0x19
 
 #define LSM6DSV_FIFO_STATUS1               0x1B
 #define LSM6DSV_STATUS_REG                 0x1E
@@ -31,6 +34,7 @@
 #define LSM6DSV_TAP_CFG0                   0x56
 #define LSM6DSV_WAKE_UP_THS                0x5B
 #define LSM6DSV_MD1_CFG                    0x5E
+#define LSM6DSV_MD2_CFG                    0x5F
 
 #define LSM6DSV_FIFO_DATA_OUT_TAG          0x78
 
@@ -97,6 +101,7 @@ int lsm_init(float clock_rate, float accel_time, float gyro_time, float *accel_a
 void lsm_shutdown(void);
 
 void lsm_update_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
+int lsm_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
 int lsm_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time);
 
 uint16_t lsm_fifo_read(uint8_t *data, uint16_t len);
@@ -109,6 +114,8 @@ uint8_t lsm_setup_WOM(void);
 
 int lsm_ext_setup(void);
 int lsm_ext_passthrough(bool passthrough);
+int lsm_ext_fifo_setup(uint8_t addr, uint8_t reg, uint8_t len, float time, float *actual_time);
+int lsm_fifo_process_ext(uint16_t index, uint8_t *data, uint8_t *raw_ext);
 
 int lsm_ext_write(const uint8_t addr, const uint8_t *buf, uint32_t num_bytes);
 int lsm_ext_write_read(const uint8_t addr, const void *write_buf, size_t num_write, void *read_buf, size_t num_read);
@@ -0,0 +1,363 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2025 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#include <math.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "imu_array.h"
+
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+
+#define SATURATION_LIMIT 0.98f // fraction of the range treated as saturated
+#define BIAS_ALPHA 0.001f // bias relative to the primary IMU, ~1s at 1kHz
+#define NOISE_BETA 0.01f // noise estimate from the sample to sample difference while stationary
+#define NOISE_MIN 1e-6f
+#define STILL_GYRO 5.0f // dps, primary gyro (including bias) below this is treated as stationary
+#define STILL_ACCEL 0.05f // g, primary accel magnitude within this of 1g is treated as stationary
+#define FAULT_LIMIT 10 // reads without data before the IMU is excluded
+#define ALIGN_LIMIT 0.3f // g, accel difference to the primary IMU at rest that means a different mounting orientation
+#define ALIGN_SAMPLES 200 // consecutive samples at rest over the limit before the IMU is excluded
+
+typedef struct sensor_array_unit {
+	uint8_t *data;
+	uint16_t packets;
+	uint16_t count[2]; // valid samples, accel and gyro, counted once after the read
+	uint16_t cursor[2]; // next packet to decode, accel and gyro
+	int offset[2]; // aux samples to skip (positive) or primary samples without a pair (negative)
+	float bias[2][3]; // offset from the primary IMU
+	float noise[2]; // variance estimate
+	float last[2][3];
+	bool last_valid[2];
+	uint16_t misaligned; // consecutive samples at rest over ALIGN_LIMIT
+	uint8_t faults;
+	bool active;
+} sensor_array_unit_t;
+
+enum {
+	ARRAY_ACCEL,
+	ARRAY_GYRO
+};
+
+static sensor_array_unit_t units[SENSOR_INTERFACE_IMU_MAX]; // unit 0 is the primary IMU
+static int unit_count;
+static const sensor_imu_t *array_imu;
+static float array_range[2]; // range the current FIFO read was captured at
+static float array_range_next[2];
+static float array_scale[2] = {1, 1}; // aux samples of the current FIFO read are decoded with the new sensitivity
+static bool array_still[2]; // primary IMU is stationary, by accel and gyro
+
+LOG_MODULE_REGISTER(sensor_array, LOG_LEVEL_INF);
+
+void sensor_array_init(const sensor_imu_t *imu, float accel_range, float gyro_range)
+{
+	memset(units, 0, sizeof(units));
+	memset(array_still, 0, sizeof(array_still));
+	unit_count = sensor_interface_imu_count();
+	array_imu = imu;
+	array_range[ARRAY_ACCEL] = array_range_next[ARRAY_ACCEL] = accel_range;
+	array_range[ARRAY_GYRO] = array_range_next[ARRAY_GYRO] = gyro_range;
+	array_scale[ARRAY_ACCEL] = array_scale[ARRAY_GYRO] = 1;
+	for (int i = 0; i < unit_count; i++)
+	{
+		units[i].active = true;
+		units[i].noise[ARRAY_ACCEL] = 1;
+		units[i].noise[ARRAY_GYRO] = 1;
+	}
+	if (unit_count > 1)
+		LOG_INF("Using %d IMUs", unit_count);
+}
+
+// Called right after the FIFO read, the new range applies from the next read
+void sensor_array_update_fs(float accel_range, float gyro_range)
+{
+	array_scale[ARRAY_ACCEL] = array_range[ARRAY_ACCEL] / accel_range;
+	array_scale[ARRAY_GYRO] = array_range[ARRAY_GYRO] / gyro_range;
+	array_range_next[ARRAY_ACCEL] = accel_range;
+	array_range_next[ARRAY_GYRO] = gyro_range;
+}
+
+int sensor_array_count(void)
+{
+	int count = 0;
+	for (int i = 0; i < unit_count; i++)
+		count += units[i].active;
+	return count;
+}
+
+// Decode with the unit selected, the driver only keeps state from FIFO data (temperature) for the primary IMU
+static int unit_fifo_process(int index, uint16_t packet, uint8_t *data, float a[3], float g[3])
+{
+	sensor_interface_imu_select(index);
+	int err = array_imu->fifo_process(packet, data, a, g);
+	sensor_interface_imu_select(-1);
+	return err;
+}
+
+static bool sample_valid(const float v[3])
+{
+	return v[0] != 0 || v[1] != 0 || v[2] != 0;
+}
+
+// Count accel and gyro samples in one pass, used to align the newest samples with the primary IMU
+static void count_samples(int index, uint8_t *data, uint16_t packets, uint16_t count[2])
+{
+	count[ARRAY_ACCEL] = 0;
+	count[ARRAY_GYRO] = 0;
+	for (uint16_t i = 0; i < packets; i++)
+	{
+		float a[3] = {0};
+		float g[3] = {0};
+		if (unit_fifo_process(index, i, data, a, g))
+			continue;
+		count[ARRAY_ACCEL] += sample_valid(a);
+		count[ARRAY_GYRO] += sample_valid(g);
+	}
+}
+
+// Read aux IMU FIFOs right after the primary IMU so the newest samples line up
+void sensor_array_read(uint16_t len)
+{
+	for (int i = 1; i < unit_count; i++)
+	{
+		sensor_array_unit_t *unit = &units[i];
+		unit->packets = 0;
+		unit->count[ARRAY_ACCEL] = 0;
+		unit->count[ARRAY_GYRO] = 0;
+		if (!unit->active)
+			continue;
+		unit->data = (uint8_t *)k_malloc(len);
+		if (unit->data == NULL)
+		{
+			LOG_ERR("Failed to allocate memory for FIFO buffer");
+			continue;
+		}
+		sensor_interface_imu_select(i);
+		unit->packets = array_imu->fifo_read(unit->data, len);
+		sensor_interface_imu_select(-1);
+		count_samples(i, unit->data, unit->packets, unit->count);
+	}
+}
+
+static bool unit_next(sensor_array_unit_t *unit, int type, float v[3])
+{
+	while (unit->cursor[type] < unit->packets)
+	{
+		float a[3] = {0};
+		float g[3] = {0};
+		int err = unit_fifo_process(unit - units, unit->cursor[type]++, unit->data, a, g);
+		float *s = type == ARRAY_GYRO ? g : a;
+		if (!err && sample_valid(s))
+		{
+			for (int i = 0; i < 3; i++)
+				v[i] = s[i] * array_scale[type];
+			return true;
+		}
+	}
+	return false;
+}
+
+// Align the newest samples of each IMU, both FIFOs were read at nearly the same time
+void sensor_array_begin(uint8_t *data, uint16_t packets)
+{
+	if (unit_count < 2)
+		return;
+	uint16_t primary[2];
+	count_samples(0, data, packets, primary);
+	for (int i = 1; i < unit_count; i++)
+	{
+		sensor_array_unit_t *unit = &units[i];
+		if (!unit->active || unit->data == NULL)
+			continue;
+		for (int type = 0; type < 2; type++)
+		{
+			unit->cursor[type] = 0;
+			unit->offset[type] = unit->count[type] - primary[type];
+			float v[3];
+			for (; unit->offset[type] > 0; unit->offset[type]--)
+				unit_next(unit, type, v); // discard older samples
+		}
+	}
+}
+
+// All IMUs must be mounted in the same orientation, there is no axis remapping for aux IMUs
+static void check_alignment(sensor_array_unit_t *unit, const float s[3], const float v[3])
+{
+	if (!array_still[ARRAY_ACCEL] || !array_still[ARRAY_GYRO])
+		return;
+	float d = 0;
+	for (int i = 0; i < 3; i++)
+		d += (s[i] - v[i]) * (s[i] - v[i]);
+	if (d < ALIGN_LIMIT * ALIGN_LIMIT)
+	{
+		unit->misaligned = 0;
+	}
+	else if (++unit->misaligned == ALIGN_SAMPLES)
+	{
+		unit->active = false;
+		LOG_WRN("IMU %d is not mounted in the same orientation as the primary IMU, removed from array", (int)(unit - units));
+	}
+}
+
+static bool saturated(const float v[3], int type)
+{
+	float limit = array_range[type] * SATURATION_LIMIT;
+	return fabsf(v[0]) > limit || fabsf(v[1]) > limit || fabsf(v[2]) > limit;
+}
+
+static void update_still(const float v[3], int type)
+{
+	float norm = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (type == ARRAY_GYRO)
+		array_still[type] = norm < STILL_GYRO;
+	else
+		array_still[type] = fabsf(norm - 1) < STILL_ACCEL;
+}
+
+// Sample to sample difference is only sensor noise while stationary, motion would dominate it otherwise
+static void update_noise(sensor_array_unit_t *unit, int type, const float v[3])
+{
+	float d = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		float diff = v[i] - unit->last[type][i];
+		d += diff * diff;
+		unit->last[type][i] = v[i];
+	}
+	bool last_valid = unit->last_valid[type];
+	unit->last_valid[type] = true;
+	if (!last_valid || !array_still[ARRAY_ACCEL] || !array_still[ARRAY_GYRO])
+		return;
+	unit->noise[type] += NOISE_BETA * (d - unit->noise[type]);
+	if (unit->noise[type] < NOISE_MIN)
+		unit->noise[type] = NOISE_MIN;
+}
+
+static void merge(float v[3], int type)
+{
+	bool primary_saturated = saturated(v, type);
+	update_still(v, type);
+	update_noise(&units[0], type, v);
+	float sum[3] = {0};
+	float weight_sum = 0;
+	if (!primary_saturated)
+	{
+		float w = 1.0f / units[0].noise[type];
+		for (int i = 0; i < 3; i++)
+			sum[i] = v[i] * w;
+		weight_sum = w;
+	}
+	for (int u = 1; u < unit_count; u++)
+	{
+		sensor_array_unit_t *unit = &units[u];
+		if (!unit->active || unit->data == NULL)
+			continue;
+		if (unit->offset[type] < 0)
+		{
+			unit->offset[type]++; // no sample for this primary sample
+			continue;
+		}
+		float s[3];
+		if (!unit_next(unit, type, s))
+			continue;
+		update_noise(unit, type, s);
+		if (saturated(s, type))
+			continue;
+		if (type == ARRAY_ACCEL && !primary_saturated)
+		{
+			check_alignment(unit, s, v);
+			if (!unit->active)
+				continue;
+		}
+		if (!primary_saturated)
+		{
+			for (int i = 0; i < 3; i++)
+				unit->bias[type][i] += BIAS_ALPHA * ((s[i] - v[i]) - unit->bias[type][i]);
+		}
+		float w = 1.0f / unit->noise[type];
+		for (int i = 0; i < 3; i++)
+			sum[i] += (s[i] - unit->bias[type][i]) * w;
+		weight_sum += w;
+	}
+	if (weight_sum > 0)
+	{
+		for (int i = 0; i < 3; i++)
+			v[i] = sum[i] / weight_sum;
+	}
+}
+
+// Merge aux samples into a primary sample, before calibration
+void sensor_array_process(float a[3], float g[3])
+{
+	if (unit_count < 2)
+		return;
+	if (g[0] != 0 || g[1] != 0 || g[2] != 0)
+		merge(g, ARRAY_GYRO);
+	if (a[0] != 0 || a[1] != 0 || a[2] != 0)
+		merge(a, ARRAY_ACCEL);
+}
+
+void sensor_array_end(uint16_t packets)
+{
+	for (int type = 0; type < 2; type++)
+	{
+		array_range[type] = array_range_next[type];
+		array_scale[type] = 1;
+	}
+	for (int i = 1; i < unit_count; i++)
+	{
+		sensor_array_unit_t *unit = &units[i];
+		if (unit->data != NULL)
+		{
+			k_free(unit->data);
+			unit->data = NULL;
+		}
+		if (!unit->active)
+			continue;
+		if (packets > 0 && unit->packets == 0)
+		{
+			if (++unit->faults == FAULT_LIMIT)
+			{
+				unit->active = false;
+				LOG_WRN("IMU %d not responding, removed from array", i);
+			}
+		}
+		else
+		{
+			unit->faults = 0;
+		}
+	}
+}
+
+#else
+
+void sensor_array_init(const sensor_imu_t *imu, float accel_range, float gyro_range) {}
+void sensor_array_update_fs(float accel_range, float gyro_range) {}
+int sensor_array_count(void) { return 1; }
+void sensor_array_read(uint16_t len) {}
+void sensor_array_begin(uint8_t *data, uint16_t packets) {}
+void sensor_array_process(float a[3], float g[3]) {}
+void sensor_array_end(uint16_t packets) {}
+
+#endif
@@ -0,0 +1,38 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2025 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#ifndef SLIMENRF_SENSOR_IMU_ARRAY
+#define SLIMENRF_SENSOR_IMU_ARRAY
+
+#include "sensor.h"
+
+/* Additional IMUs of the same model are merged into the primary IMU samples */
+void sensor_array_init(const sensor_imu_t *imu, float accel_range, float gyro_range);
+void sensor_array_update_fs(float accel_range, float gyro_range);
+int sensor_array_count(void);
+
+void sensor_array_read(uint16_t len);
+void sensor_array_begin(uint8_t *data, uint16_t packets);
+void sensor_array_process(float a[3], float g[3]);
+void sensor_array_end(uint16_t packets);
+
+#endif
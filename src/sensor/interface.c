@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "interface.h"
 
 #include <zephyr/logging/log.h>
@@ -34,26 +36,202 @@ struct spi_buf_set rx = {.buffers = rx_bufs, .count = 2};
 
 // TODO: also keep reference to sensor device drivers (such as for ext mag)
 
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+// IMU slots, the selected slot is loaded as SENSOR_INTERFACE_DEV_IMU, slot 0 is the primary IMU
+static struct spi_dt_spec *imu_slot_spi[SENSOR_INTERFACE_IMU_MAX];
+static struct i2c_dt_spec *imu_slot_i2c[SENSOR_INTERFACE_IMU_MAX];
+static enum sensor_interface_spec imu_slot_spec[SENSOR_INTERFACE_IMU_MAX];
+static uint32_t imu_slot_dummy_reads[SENSOR_INTERFACE_IMU_MAX];
+static int imu_slot_count = 0;
+static int imu_selected = -1; // -1 writes to all IMUs and reads from the primary IMU
+
+static void imu_slot_load(int index)
+{
+	sensor_interface_dev_spi[SENSOR_INTERFACE_DEV_IMU] = imu_slot_spi[index];
+	sensor_interface_dev_i2c[SENSOR_INTERFACE_DEV_IMU] = imu_slot_i2c[index];
+	sensor_interface_dev_spec[SENSOR_INTERFACE_DEV_IMU] = imu_slot_spec[index];
+	sensor_interface_dev_spi_dummy_reads[SENSOR_INTERFACE_DEV_IMU] = imu_slot_dummy_reads[index];
+}
+
+static inline bool imu_broadcast(enum sensor_interface_dev dev)
+{
+	return dev == SENSOR_INTERFACE_DEV_IMU && imu_selected < 0 && imu_slot_count > 1;
+}
+#endif
+
+#if CONFIG_SENSOR_USE_REG_CACHE
+// shadow of configuration registers, only registers marked by the driver are cached
+// registers must not change without being written (no self-clearing bits or status flags)
+static uint8_t reg_cache[SENSOR_INTERFACE_DEV_COUNT][256];
+static uint32_t reg_cache_enabled[SENSOR_INTERFACE_DEV_COUNT][8];
+static uint32_t reg_cache_valid[SENSOR_INTERFACE_DEV_COUNT][8];
+static int16_t reg_cache_bank_addr[SENSOR_INTERFACE_DEV_COUNT] = {-1, -1};
+static bool reg_cache_bypass[SENSOR_INTERFACE_DEV_COUNT];
+
+static void reg_cache_clear(enum sensor_interface_dev dev)
+{
+	memset(reg_cache_enabled[dev], 0, sizeof(reg_cache_enabled[dev]));
+	memset(reg_cache_valid[dev], 0, sizeof(reg_cache_valid[dev]));
+	reg_cache_bank_addr[dev] = -1;
+	reg_cache_bypass[dev] = false;
+}
+
+static inline uint8_t reg_cache_addr(enum sensor_interface_dev dev, uint8_t reg_addr)
+{
+	if (sensor_interface_dev_spec[dev] == SENSOR_INTERFACE_SPEC_SPI)
+		reg_addr &= 0x7F; // clear read bit
+	return reg_addr;
+}
+
+static inline bool reg_cache_is_enabled(enum sensor_interface_dev dev, uint8_t reg_addr)
+{
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	if (dev == SENSOR_INTERFACE_DEV_IMU && imu_selected > 0)
+		return false; // cache follows the primary IMU
+#endif
+	return !reg_cache_bypass[dev] && (reg_cache_enabled[dev][reg_addr >> 5] & BIT(reg_addr & 0x1F));
+}
+
+static inline bool reg_cache_is_valid(enum sensor_interface_dev dev, uint8_t reg_addr)
+{
+	return reg_cache_is_enabled(dev, reg_addr) && (reg_cache_valid[dev][reg_addr >> 5] & BIT(reg_addr & 0x1F));
+}
+
+static void reg_cache_store(enum sensor_interface_dev dev, uint8_t start_addr, const uint8_t *buf, uint32_t num_bytes)
+{
+	start_addr = reg_cache_addr(dev, start_addr);
+	for (uint32_t i = 0; i < num_bytes && start_addr + i < 256; i++)
+	{
+		uint8_t reg_addr = start_addr + i;
+		if (reg_cache_bank_addr[dev] == reg_addr)
+			reg_cache_bypass[dev] = buf[i] != 0; // other register banks are not cached
+		if (!reg_cache_is_enabled(dev, reg_addr))
+			continue;
+		reg_cache[dev][reg_addr] = buf[i];
+		reg_cache_valid[dev][reg_addr >> 5] |= BIT(reg_addr & 0x1F);
+	}
+}
+#endif
+
+// mark registers start_addr to end_addr as cacheable, these must only change when written
+void ssi_reg_cache_enable(enum sensor_interface_dev dev, uint8_t start_addr, uint8_t end_addr)
+{
+#if CONFIG_SENSOR_USE_REG_CACHE
+	for (int i = start_addr; i <= end_addr; i++)
+		reg_cache_enabled[dev][i >> 5] |= BIT(i & 0x1F);
+#endif
+}
+
+// the cache is bypassed while the bank register is nonzero
+void ssi_reg_cache_bank(enum sensor_interface_dev dev, uint8_t bank_addr)
+{
+#if CONFIG_SENSOR_USE_REG_CACHE
+	reg_cache_bank_addr[dev] = bank_addr;
+#endif
+}
+
+// must be called when the device is reset
+void ssi_reg_cache_invalidate(enum sensor_interface_dev dev)
+{
+#if CONFIG_SENSOR_USE_REG_CACHE
+	memset(reg_cache_valid[dev], 0, sizeof(reg_cache_valid[dev]));
+	reg_cache_bypass[dev] = false;
+#endif
+}
+
 void sensor_interface_register_sensor_imu_spi(struct spi_dt_spec *dev)
 {
+#if CONFIG_SENSOR_USE_REG_CACHE
+	reg_cache_clear(SENSOR_INTERFACE_DEV_IMU);
+#endif
 	sensor_interface_dev_spi[SENSOR_INTERFACE_DEV_IMU] = dev;
 	sensor_interface_dev_spec[SENSOR_INTERFACE_DEV_IMU] = SENSOR_INTERFACE_SPEC_SPI;
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	imu_slot_spi[0] = dev;
+	imu_slot_spec[0] = SENSOR_INTERFACE_SPEC_SPI;
+	imu_slot_dummy_reads[0] = 0;
+	imu_slot_count = 1; // aux IMUs are registered after the primary IMU
+	imu_selected = -1;
+#endif
 }
 
 void sensor_interface_register_sensor_imu_i2c(struct i2c_dt_spec *dev)
 {
+#if CONFIG_SENSOR_USE_REG_CACHE
+	reg_cache_clear(SENSOR_INTERFACE_DEV_IMU);
+#endif
 	sensor_interface_dev_i2c[SENSOR_INTERFACE_DEV_IMU] = dev;
 	sensor_interface_dev_spec[SENSOR_INTERFACE_DEV_IMU] = SENSOR_INTERFACE_SPEC_I2C;
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	imu_slot_i2c[0] = dev;
+	imu_slot_spec[0] = SENSOR_INTERFACE_SPEC_I2C;
+	imu_slot_dummy_reads[0] = 0;
+	imu_slot_count = 1; // aux IMUs are registered after the primary IMU
+	imu_selected = -1;
+#endif
+}
+
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+// aux IMUs must be the same device as the primary IMU, returns the slot or -1
+int sensor_interface_register_sensor_imu_aux_spi(struct spi_dt_spec *dev)
+{
+	if (imu_slot_count < 1 || imu_slot_count >= SENSOR_INTERFACE_IMU_MAX)
+		return -1;
+	imu_slot_spi[imu_slot_count] = dev;
+	imu_slot_spec[imu_slot_count] = SENSOR_INTERFACE_SPEC_SPI;
+	imu_slot_dummy_reads[imu_slot_count] = 0;
+	return imu_slot_count++;
+}
+
+int sensor_interface_register_sensor_imu_aux_i2c(struct i2c_dt_spec *dev)
+{
+	if (imu_slot_count < 1 || imu_slot_count >= SENSOR_INTERFACE_IMU_MAX)
+		return -1;
+	imu_slot_i2c[imu_slot_count] = dev;
+	imu_slot_spec[imu_slot_count] = SENSOR_INTERFACE_SPEC_I2C;
+	imu_slot_dummy_reads[imu_slot_count] = 0;
+	return imu_slot_count++;
+}
+
+int sensor_interface_imu_count(void)
+{
+	return imu_slot_count;
+}
+
+// select a single IMU for reads and writes, or -1 to write to all IMUs and read from the primary IMU
+void sensor_interface_imu_select(int index)
+{
+	if (index >= imu_slot_count || imu_slot_count == 0)
+		return;
+	imu_selected = index;
+	imu_slot_load(index < 0 ? 0 : index);
+}
+#endif
+
+// drivers only keep state derived from FIFO data when decoding the primary IMU
+bool sensor_interface_imu_primary(void)
+{
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	return imu_selected <= 0;
+#else
+	return true;
+#endif
 }
 
 void sensor_interface_register_sensor_mag_spi(struct spi_dt_spec *dev)
 {
+#if CONFIG_SENSOR_USE_REG_CACHE
+	reg_cache_clear(SENSOR_INTERFACE_DEV_MAG);
+#endif
 	sensor_interface_dev_spi[SENSOR_INTERFACE_DEV_MAG] = dev;
 	sensor_interface_dev_spec[SENSOR_INTERFACE_DEV_MAG] = SENSOR_INTERFACE_SPEC_SPI;
 }
 
 void sensor_interface_register_sensor_mag_i2c(struct i2c_dt_spec *dev) // also used for passthrough
 {
+#if CONFIG_SENSOR_USE_REG_CACHE
+	reg_cache_clear(SENSOR_INTERFACE_DEV_MAG);
+#endif
 	sensor_interface_dev_i2c[SENSOR_INTERFACE_DEV_MAG] = dev;
 	sensor_interface_dev_spec[SENSOR_INTERFACE_DEV_MAG] = SENSOR_INTERFACE_SPEC_I2C;
 }
@@ -76,6 +254,9 @@ int sensor_interface_register_sensor_mag_ext(uint8_t addr, uint8_t min_burst, ui
 			}
 			min_ext_burst = min_burst;
 			ext_addr = addr;
+#if CONFIG_SENSOR_USE_REG_CACHE
+			reg_cache_clear(SENSOR_INTERFACE_DEV_MAG);
+#endif
 			sensor_interface_dev_spec[SENSOR_INTERFACE_DEV_MAG] = SENSOR_INTERFACE_SPEC_EXT;
 			return 0;
 		}
@@ -101,6 +282,18 @@ int sensor_interface_spi_configure(enum sensor_interface_dev dev, uint32_t frequ
 		return -1; // no spi device registered
 	sensor_interface_dev_spi[dev]->config.frequency = frequency;
 	sensor_interface_dev_spi_dummy_reads[dev] = dummy_reads; // shoutout to BMI270
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	if (dev == SENSOR_INTERFACE_DEV_IMU)
+	{
+		for (int i = 0; i < imu_slot_count; i++)
+		{
+			if (imu_slot_spec[i] != SENSOR_INTERFACE_SPEC_SPI || (imu_selected >= 0 && i != imu_selected))
+				continue;
+			imu_slot_spi[i]->config.frequency = frequency;
+			imu_slot_dummy_reads[i] = dummy_reads;
+		}
+	}
+#endif
 	return 0;
 }
 
@@ -116,7 +309,7 @@ const sensor_ext_ssi_t *sensor_interface_ext_get(void)
 
 // TODO: spi config by device
 
-int ssi_write(enum sensor_interface_dev dev, const uint8_t *buf, uint32_t num_bytes)
+static int bus_write(enum sensor_interface_dev dev, const uint8_t *buf, uint32_t num_bytes)
 {
 	switch (sensor_interface_dev_spec[dev])
 	{
@@ -148,6 +341,24 @@ int ssi_write(enum sensor_interface_dev dev, const uint8_t *buf, uint32_t num_by
 	}
 }
 
+int ssi_write(enum sensor_interface_dev dev, const uint8_t *buf, uint32_t num_bytes)
+{
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	if (imu_broadcast(dev)) // configure all IMUs the same
+	{
+		int err = 0;
+		for (int i = 0; i < imu_slot_count; i++)
+		{
+			imu_slot_load(i);
+			err |= bus_write(dev, buf, num_bytes);
+		}
+		imu_slot_load(0);
+		return err;
+	}
+#endif
+	return bus_write(dev, buf, num_bytes);
+}
+
 int ssi_read(enum sensor_interface_dev dev, uint8_t *buf, uint32_t num_bytes)
 {
 	switch (sensor_interface_dev_spec[dev])
@@ -181,7 +392,17 @@ int ssi_read(enum sensor_interface_dev dev, uint8_t *buf, uint32_t num_bytes)
 		return i2c_read_dt(sensor_interface_dev_i2c[dev], buf, num_bytes);
 	case SENSOR_INTERFACE_SPEC_EXT:
 		if (ext_ssi != NULL)
+		{
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+			int selected = imu_selected;
+			sensor_interface_imu_select(0); // external interface is on the primary IMU
+			int err = ext_ssi->ext_write(ext_addr, buf, num_bytes);
+			sensor_interface_imu_select(selected);
+			return err;
+#else
 			return ext_ssi->ext_write(ext_addr, buf, num_bytes);
+#endif
+		}
 	default:
 		return -1;
 	}
@@ -227,7 +448,15 @@ int ssi_write_read(enum sensor_interface_dev dev, const void *write_buf, size_t
 		{
 			if (num_read > ext_ssi->ext_burst)
 				num_read = min_ext_burst;
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+			int selected = imu_selected;
+			sensor_interface_imu_select(0); // external interface is on the primary IMU
+			int err = ext_ssi->ext_write_read(ext_addr, write_buf, num_write, read_buf, num_read);
+			sensor_interface_imu_select(selected);
+			return err;
+#else
 			return ext_ssi->ext_write_read(ext_addr, write_buf, num_write, read_buf, num_read);
+#endif
 		}
 	default:
 		return -1;
@@ -241,7 +470,7 @@ int ssi_burst_read(enum sensor_interface_dev dev, uint8_t start_addr, uint8_t *b
 	return ssi_write_read(dev, &start_addr, 1, buf, num_bytes);
 }
 
-int ssi_burst_write(enum sensor_interface_dev dev, uint8_t start_addr, const uint8_t *buf, uint32_t num_bytes)
+static int burst_write(enum sensor_interface_dev dev, uint8_t start_addr, const uint8_t *buf, uint32_t num_bytes)
 {
 	switch (sensor_interface_dev_spec[dev])
 	{
@@ -276,17 +505,73 @@ int ssi_burst_write(enum sensor_interface_dev dev, uint8_t start_addr, const uin
 	}
 }
 
+int ssi_burst_write(enum sensor_interface_dev dev, uint8_t start_addr, const uint8_t *buf, uint32_t num_bytes)
+{
+#if CONFIG_SENSOR_USE_REG_CACHE
+	uint32_t cached = 0;
+	while (cached < num_bytes && start_addr + cached < 256 && reg_cache_is_valid(dev, start_addr + cached) && reg_cache[dev][start_addr + cached] == buf[cached])
+		cached++;
+	if (cached == num_bytes)
+		return 0; // already written
+#endif
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	int err = 0;
+	if (imu_broadcast(dev)) // configure all IMUs the same
+	{
+		for (int i = 0; i < imu_slot_count; i++)
+		{
+			imu_slot_load(i);
+			err |= burst_write(dev, start_addr, buf, num_bytes);
+		}
+		imu_slot_load(0);
+	}
+	else
+	{
+		err = burst_write(dev, start_addr, buf, num_bytes);
+	}
+#else
+	int err = burst_write(dev, start_addr, buf, num_bytes);
+#endif
+#if CONFIG_SENSOR_USE_REG_CACHE
+	if (!err)
+		reg_cache_store(dev, start_addr, buf, num_bytes);
+#endif
+	return err;
+}
+
 int ssi_reg_read_byte(enum sensor_interface_dev dev, uint8_t reg_addr, uint8_t *value)
 {
+#if CONFIG_SENSOR_USE_REG_CACHE
+	uint8_t cache_addr = reg_cache_addr(dev, reg_addr);
+	if (reg_cache_is_valid(dev, cache_addr))
+	{
+		*value = reg_cache[dev][cache_addr];
+		return 0;
+	}
+#endif
 	if (sensor_interface_dev_spec[dev] == SENSOR_INTERFACE_SPEC_SPI)
 		reg_addr |= 0x80; // set read bit
-	return ssi_write_read(dev, &reg_addr, 1, value, 1);
+	int err = ssi_write_read(dev, &reg_addr, 1, value, 1);
+#if CONFIG_SENSOR_USE_REG_CACHE
+	if (!err)
+		reg_cache_store(dev, cache_addr, value, 1);
+#endif
+	return err;
 }
 
 int ssi_reg_write_byte(enum sensor_interface_dev dev, uint8_t reg_addr, uint8_t value)
 {
+#if CONFIG_SENSOR_USE_REG_CACHE
+	if (reg_cache_is_valid(dev, reg_addr) && reg_cache[dev][reg_addr] == value)
+		return 0; // already written
+#endif
 	uint8_t buf[2] = {reg_addr, value};
-	return ssi_write(dev, buf, 2);
+	int err = ssi_write(dev, buf, 2);
+#if CONFIG_SENSOR_USE_REG_CACHE
+	if (!err)
+		reg_cache_store(dev, reg_addr, &value, 1);
+#endif
+	return err;
 }
 
 int ssi_reg_update_byte(enum sensor_interface_dev dev, uint8_t reg_addr, uint8_t mask, uint8_t value)
@@ -306,6 +591,46 @@ int ssi_reg_update_byte(enum sensor_interface_dev dev, uint8_t reg_addr, uint8_t
 	return ssi_reg_write_byte(dev, reg_addr, new_value);
 }
 
+#define SSI_SEQ_MAX_BURST 16
+
+int ssi_reg_write_seq(enum sensor_interface_dev dev, const ssi_reg_seq_t *seq, uint32_t count)
+{
+	int err = 0;
+	uint8_t buf[SSI_SEQ_MAX_BURST];
+	uint32_t i = 0;
+	while (i < count)
+	{
+		const ssi_reg_seq_t *entry = &seq[i];
+		if (entry->mask != 0xFF)
+		{
+			err |= ssi_reg_update_byte(dev, entry->reg, entry->mask, entry->value);
+			i++;
+		}
+		else
+		{
+			uint32_t len = 0;
+			buf[len++] = entry->value;
+			// extend the burst while the next entry is a full write to the next register
+			while (i + len < count && len < SSI_SEQ_MAX_BURST && seq[i + len - 1].delay_us == 0 && seq[i + len].mask == 0xFF && seq[i + len].reg == entry->reg + len)
+			{
+				buf[len] = seq[i + len].value;
+				len++;
+			}
+			if (len == 1)
+				err |= ssi_reg_write_byte(dev, entry->reg, buf[0]);
+			else
+				err |= ssi_burst_write(dev, entry->reg, buf, len);
+			i += len;
+			entry = &seq[i - 1];
+		}
+		if (entry->delay_us >= 1000)
+			k_usleep(entry->delay_us);
+		else if (entry->delay_us > 0)
+			k_busy_wait(entry->delay_us);
+	}
+	return err;
+}
+
 int ssi_reg_read_interval(enum sensor_interface_dev dev, uint8_t start_addr, uint8_t *buf, uint32_t num_bytes, uint32_t interval)
 {
 #if DEBUG || DEBUG_RATE
@@ -33,6 +33,8 @@ enum sensor_interface_dev
 };
 #define SENSOR_INTERFACE_DEV_COUNT 2
 
+#define SENSOR_INTERFACE_IMU_MAX 3 // primary IMU and aux IMUs
+
 enum sensor_interface_spec
 {
 	SENSOR_INTERFACE_SPEC_SPI,
@@ -40,6 +42,19 @@ enum sensor_interface_spec
 	SENSOR_INTERFACE_SPEC_EXT
 };
 
+// register write sequence entry, mask 0xFF writes the whole register, otherwise the register is read-modify-written
+// consecutive full writes to adjacent registers are coalesced into one burst (device must auto-increment on write)
+// a nonzero delay is waited after the write, and ends any burst
+typedef struct ssi_reg_seq {
+	uint8_t reg;
+	uint8_t mask;
+	uint8_t value;
+	uint16_t delay_us;
+} ssi_reg_seq_t;
+
+#define SSI_SEQ_WRITE(r, v) {(r), 0xFF, (v), 0}
+#define SSI_SEQ_WRITE_DELAY(r, v, us) {(r), 0xFF, (v), (us)}
+
 typedef struct sensor_ext_ssi {
 	int (*ext_write)(const uint8_t, const uint8_t*, uint32_t);
 	int (*ext_write_read)(const uint8_t, const void*, size_t, void*, size_t);
@@ -49,6 +64,12 @@ typedef struct sensor_ext_ssi {
 void sensor_interface_register_sensor_imu_spi(struct spi_dt_spec *dev);
 void sensor_interface_register_sensor_imu_i2c(struct i2c_dt_spec *dev);
 
+int sensor_interface_register_sensor_imu_aux_spi(struct spi_dt_spec *dev);
+int sensor_interface_register_sensor_imu_aux_i2c(struct i2c_dt_spec *dev);
+int sensor_interface_imu_count(void);
+void sensor_interface_imu_select(int index);
+bool sensor_interface_imu_primary(void);
+
 void sensor_interface_register_sensor_mag_spi(struct spi_dt_spec *dev);
 void sensor_interface_register_sensor_mag_i2c(struct i2c_dt_spec *dev);
 int sensor_interface_register_sensor_mag_ext(uint8_t addr, uint8_t min_burst, uint8_t burst);
@@ -57,6 +78,11 @@ int sensor_interface_spi_configure(enum sensor_interface_dev dev, uint32_t frequ
 void sensor_interface_ext_configure(const sensor_ext_ssi_t *ext);
 const sensor_ext_ssi_t *sensor_interface_ext_get(void);
 
+// cached registers must be written with ssi_reg_write_byte, ssi_reg_update_byte or ssi_burst_write
+void ssi_reg_cache_enable(enum sensor_interface_dev dev, uint8_t start_addr, uint8_t end_addr);
+void ssi_reg_cache_bank(enum sensor_interface_dev dev, uint8_t bank_addr);
+void ssi_reg_cache_invalidate(enum sensor_interface_dev dev);
+
 int ssi_write(enum sensor_interface_dev dev, const uint8_t *buf, uint32_t num_bytes);
 int ssi_read(enum sensor_interface_dev dev, uint8_t *buf, uint32_t num_bytes);
 int ssi_write_read(enum sensor_interface_dev dev, const void *write_buf, size_t num_write, void *read_buf, size_t num_read);
@@ -67,6 +93,8 @@ int ssi_reg_read_byte(enum sensor_interface_dev dev, uint8_t reg_addr, uint8_t *
 int ssi_reg_write_byte(enum sensor_interface_dev dev, uint8_t reg_addr, uint8_t value);
 int ssi_reg_update_byte(enum sensor_interface_dev dev, uint8_t reg_addr, uint8_t mask, uint8_t value);
 
+int ssi_reg_write_seq(enum sensor_interface_dev dev, const ssi_reg_seq_t *seq, uint32_t count);
+
 int ssi_reg_read_interval(enum sensor_interface_dev dev, uint8_t start_addr, uint8_t *buf, uint32_t num_bytes, uint32_t interval);
 int ssi_burst_read_interval(enum sensor_interface_dev dev, uint8_t start_addr, uint8_t *buf, uint32_t num_bytes, uint32_t interval);
 
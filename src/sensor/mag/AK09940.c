@@ -158,5 +158,5 @@ const sensor_mag_t sensor_mag_ak09940 = {
 	*ak_temp_read,
 
 	*ak_mag_process,
-	9, 9
+	9, 9, AK09940_HXL
 };
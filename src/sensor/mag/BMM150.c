@@ -309,5 +309,5 @@ const sensor_mag_t sensor_mag_bmm150 = {
 	*mag_none_temp_read,
 
 	*bmm1_mag_process,
-	6, 8 // rhall does not get read by limited external interface
+	6, 8, BMM150_DATAX_LSB // rhall does not get read by limited external interface
 };
@@ -234,5 +234,5 @@ const sensor_mag_t sensor_mag_bmm350 = {
 	*bmm3_temp_read,
 
 	*bmm3_mag_process,
-	9, 9
+	9, 9, BMM350_MAG_X_XLSB
 };
@@ -161,5 +161,5 @@ const sensor_mag_t sensor_mag_ist8306 = {
 	*mag_none_temp_read,
 
 	*ist8306_mag_process,
-	6, 6
+	6, 6, IST8306_DATAXL
 };
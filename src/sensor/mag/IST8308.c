@@ -163,5 +163,5 @@ const sensor_mag_t sensor_mag_ist8308 = {
 	*mag_none_temp_read,
 
 	*ist8308_mag_process,
-	6, 6
+	6, 6, IST8306_DATAXL
 };
@@ -203,5 +203,5 @@ const sensor_mag_t sensor_mag_lis3mdl = {
 	*lis3_temp_read,
 
 	*lis3_mag_process,
-	6, 6
+	6, 6, LIS3MDL_OUT_X_L
 };
@@ -0,0 +1,202 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2025 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#include <math.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "globals.h"
+#include "imu_array.h"
+#include "range.h"
+
+#define RANGE_SENS_BASE 125.0f // gyro full scale of the first sensitivity entry
+
+static float range_gyro; // current gyro range, selects the sensitivity entry
+
+// Sensitivity error differs between ranges, each range has its own calibration
+int sensor_range_sens_index(void)
+{
+	int index = 0;
+	for (float r = RANGE_SENS_BASE * 1.5f; r < range_gyro && index < GYRO_SENS_RANGES - 1; r *= 2)
+		index++;
+	return index;
+}
+
+#if CONFIG_SENSOR_USE_DYNAMIC_FS
+
+#define RANGE_HIGH 0.9f // fraction of the range that selects the highest range
+#define RANGE_LOW 0.4f // fraction of the next lower range that allows switching down
+#define RANGE_HOLD_MS 1000 // time below the lower limit before switching down
+#define RANGE_SETTLE_US 2000 // samples after the range register write may not be settled yet
+
+enum {
+	RANGE_ACCEL,
+	RANGE_GYRO
+};
+
+static const sensor_imu_t *range_imu;
+static bool range_enabled;
+static float range[2]; // current range
+static float range_min[2]; // requested range from config
+static float range_max[2]; // highest supported range
+static float range_request[2];
+static float range_scale[2] = {1, 1}; // the current FIFO read was captured at the previous range
+static float range_peak[2];
+static int64_t range_low_time[2];
+static int range_settle_next[2]; // samples to replace in the next FIFO read
+static int range_settle[2]; // samples to replace in the current FIFO read
+static float range_last[2][3]; // last sample at a known range
+
+LOG_MODULE_REGISTER(sensor_range, LOG_LEVEL_INF);
+
+void sensor_range_init(const sensor_imu_t *imu, float accel_range, float gyro_range)
+{
+	float accel_max, gyro_max;
+	imu->update_fs(INFINITY, INFINITY, &accel_max, &gyro_max); // only calculates the range, registers are not written
+	imu->update_fs(accel_range, gyro_range, &accel_range, &gyro_range);
+	range_imu = imu;
+	range[RANGE_ACCEL] = range_min[RANGE_ACCEL] = range_request[RANGE_ACCEL] = accel_range;
+	range[RANGE_GYRO] = range_min[RANGE_GYRO] = range_request[RANGE_GYRO] = gyro_range;
+	range_max[RANGE_ACCEL] = accel_max;
+	range_max[RANGE_GYRO] = gyro_max;
+	range_gyro = gyro_range;
+	for (int t = 0; t < 2; t++)
+	{
+		range_scale[t] = 1;
+		range_peak[t] = 0;
+		range_low_time[t] = 0;
+		range_settle_next[t] = 0;
+		range_settle[t] = 0;
+	}
+	range_enabled = accel_max > accel_range || gyro_max > gyro_range;
+}
+
+void sensor_range_apply(float accel_time, float gyro_time)
+{
+	range_scale[RANGE_ACCEL] = 1;
+	range_scale[RANGE_GYRO] = 1;
+	if (!range_enabled)
+		return;
+	if (range_request[RANGE_ACCEL] == range[RANGE_ACCEL] && range_request[RANGE_GYRO] == range[RANGE_GYRO])
+		return;
+	float accel_range, gyro_range;
+	int err = range_imu->set_fs(range_request[RANGE_ACCEL], range_request[RANGE_GYRO], &accel_range, &gyro_range);
+	if (err < 0)
+	{
+		range_imu->update_fs(range[RANGE_ACCEL], range[RANGE_GYRO], &accel_range, &gyro_range); // restore sensitivity
+		range_enabled = false; // not supported or communication error, keep the current range
+		LOG_WRN("Failed to change range");
+		return;
+	}
+	if (err == 0)
+	{
+		// samples already in the buffer use the new sensitivity but were captured at the old range
+		range_scale[RANGE_ACCEL] = range[RANGE_ACCEL] / accel_range;
+		range_scale[RANGE_GYRO] = range[RANGE_GYRO] / gyro_range;
+		// the first samples of the next read were captured before the write or while settling, their range is unknown
+		if (accel_range != range[RANGE_ACCEL])
+			range_settle_next[RANGE_ACCEL] = ceilf(RANGE_SETTLE_US / 1e6f / accel_time) + 1;
+		if (gyro_range != range[RANGE_GYRO])
+			range_settle_next[RANGE_GYRO] = ceilf(RANGE_SETTLE_US / 1e6f / gyro_time) + 1;
+		sensor_array_update_fs(accel_range, gyro_range);
+		LOG_DBG("Range: %.0fg, %.0fdps", (double)accel_range, (double)gyro_range);
+	}
+	range[RANGE_ACCEL] = range_request[RANGE_ACCEL] = accel_range;
+	range[RANGE_GYRO] = range_request[RANGE_GYRO] = gyro_range;
+}
+
+// Samples of unknown range are replaced by the last sample, a gap would lose the rotation in that time
+static void range_process(float v[3], int t)
+{
+	if (v[0] == 0 && v[1] == 0 && v[2] == 0)
+		return; // no sample
+	if (range_settle[t] > 0)
+	{
+		range_settle[t]--;
+		memcpy(v, range_last[t], sizeof(range_last[t]));
+		return;
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		v[i] *= range_scale[t];
+		if (fabsf(v[i]) > range_peak[t])
+			range_peak[t] = fabsf(v[i]);
+	}
+	memcpy(range_last[t], v, sizeof(range_last[t]));
+}
+
+void sensor_range_process(float a[3], float g[3])
+{
+	if (!range_enabled)
+		return;
+	range_process(a, RANGE_ACCEL);
+	range_process(g, RANGE_GYRO);
+}
+
+void sensor_range_update(void)
+{
+	if (!range_enabled)
+		return;
+	range_gyro = range[RANGE_GYRO]; // the next FIFO read is captured at the current range
+	int64_t time = k_uptime_get();
+	for (int t = 0; t < 2; t++)
+	{
+		range_settle[t] = range_settle_next[t];
+		range_settle_next[t] = 0;
+		if (range_peak[t] > range[t] * RANGE_HIGH)
+		{
+			range_request[t] = range_max[t]; // a lower range may still saturate, use the highest
+			range_low_time[t] = 0;
+		}
+		else if (range[t] > range_min[t] && range_peak[t] < range[t] / 2 * RANGE_LOW)
+		{
+			if (range_low_time[t] == 0)
+			{
+				range_low_time[t] = time;
+			}
+			else if (time - range_low_time[t] > RANGE_HOLD_MS)
+			{
+				range_request[t] = fmaxf(range[t] / 2, range_min[t]); // one step at a time
+				range_low_time[t] = 0;
+			}
+		}
+		else
+		{
+			range_low_time[t] = 0;
+		}
+		range_peak[t] = 0;
+	}
+}
+
+#else
+
+void sensor_range_init(const sensor_imu_t *imu, float accel_range, float gyro_range)
+{
+	range_gyro = gyro_range;
+}
+void sensor_range_apply(float accel_time, float gyro_time) {}
+void sensor_range_process(float a[3], float g[3]) {}
+void sensor_range_update(void) {}
+
+#endif
@@ -0,0 +1,37 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2025 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#ifndef SLIMENRF_SENSOR_RANGE
+#define SLIMENRF_SENSOR_RANGE
+
+#include "sensor.h"
+
+/* Accelerometer and gyrometer full scale is changed at FIFO boundaries depending on the sample peaks */
+void sensor_range_init(const sensor_imu_t *imu, float accel_range, float gyro_range);
+
+void sensor_range_apply(float accel_time, float gyro_time); // call right after the FIFO read, with the current sample times
+void sensor_range_process(float a[3], float g[3]); // correct samples of the FIFO read to the range they were captured at, samples of unknown range are held
+void sensor_range_update(void); // call after all samples were processed
+
+int sensor_range_sens_index(void); // gyro sensitivity entry of the current gyro range
+
+#endif
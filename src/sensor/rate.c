@@ -0,0 +1,197 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2025 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#include <math.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "rate.h"
+
+#if CONFIG_SENSOR_USE_ADAPTIVE_RATE
+
+#define RATE_ANGLE_BUDGET 1.0f // deg of rotation per loop at the peak angular rate
+#define RATE_OVERSAMPLE 10.0f // ODR relative to the estimated motion bandwidth
+#define RATE_MOTION_MIN 2.0f // dps, below this the bandwidth estimate is only noise
+#define RATE_HOLD_MS 500 // time the demand must stay lower before stepping down
+#define RATE_LOG_INTERVAL_MS 60000
+
+// ODR divider is raised to the nearest ODR supported by the IMU in update_odr
+static const sensor_rate_level_t rate_levels[] = {
+	{6, 1}, // fast motion
+	{10, 2},
+	{16, 4},
+	{33, 1}, // slow motion or no motion (SENSOR_RATE_LEVEL_LOW_POWER), full ODR so motion after rest is tracked as before
+	{100, 1}, // long time without motion (SENSOR_RATE_LEVEL_LOW_POWER_2)
+};
+
+static int rate_level;
+static int64_t rate_hold_time;
+
+static float rate_last_g[3];
+static float rate_sum_square; // angular rate
+static float rate_diff_square; // change between samples
+static float rate_peak_square;
+static float rate_sample_time;
+static int rate_samples;
+
+static int64_t rate_level_time[ARRAY_SIZE(rate_levels)];
+static int64_t rate_last_time;
+static int64_t rate_log_time;
+
+LOG_MODULE_REGISTER(sensor_rate, LOG_LEVEL_INF);
+
+static float rate_odr(int level)
+{
+	return (float)CONFIG_SENSOR_GYRO_ODR / rate_levels[level].odr_div;
+}
+
+void sensor_rate_init(void)
+{
+	rate_level = 0; // sensor is initialized at the configured ODR
+	rate_hold_time = 0;
+	rate_sum_square = 0;
+	rate_diff_square = 0;
+	rate_peak_square = 0;
+	rate_samples = 0;
+	memset(rate_last_g, 0, sizeof(rate_last_g));
+	memset(rate_level_time, 0, sizeof(rate_level_time));
+	rate_last_time = k_uptime_get();
+	rate_log_time = rate_last_time;
+}
+
+void sensor_rate_process(const float g[3], float time)
+{
+	float square = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		float diff = g[i] - rate_last_g[i];
+		rate_diff_square += diff * diff;
+		square += g[i] * g[i];
+		rate_last_g[i] = g[i];
+	}
+	rate_sum_square += square;
+	if (square > rate_peak_square)
+		rate_peak_square = square;
+	rate_sample_time = time;
+	rate_samples++;
+}
+
+static void rate_log(void)
+{
+	int64_t total = 0;
+	for (int i = 0; i < ARRAY_SIZE(rate_levels); i++)
+		total += rate_level_time[i];
+	if (total == 0)
+		return;
+	char buf[128];
+	int len = 0;
+	for (int i = 0; i < ARRAY_SIZE(rate_levels) && len < sizeof(buf); i++)
+		len += snprintk(buf + len, sizeof(buf) - len, " %ums/%.0fHz %lld%%", rate_levels[i].loop_ms, (double)rate_odr(i), rate_level_time[i] * 100 / total);
+	LOG_INF("Sensor rate:%s", buf);
+	memset(rate_level_time, 0, sizeof(rate_level_time));
+}
+
+int sensor_rate_update(int min_level)
+{
+	int64_t time = k_uptime_get();
+	rate_level_time[rate_level] += time - rate_last_time;
+	rate_last_time = time;
+	if (time - rate_log_time > RATE_LOG_INTERVAL_MS)
+	{
+		rate_log();
+		rate_log_time = time;
+	}
+
+	if (rate_samples == 0)
+		return rate_level;
+
+	// Mean frequency of the angular rate, from the ratio of the rate of change to the rate
+	float bandwidth = 0;
+	if (rate_sum_square > rate_samples * RATE_MOTION_MIN * RATE_MOTION_MIN)
+		bandwidth = sqrtf(rate_diff_square / rate_sum_square) / (2.0f * (float)M_PI * rate_sample_time);
+	float peak = sqrtf(rate_peak_square);
+	rate_sum_square = 0;
+	rate_diff_square = 0;
+	rate_peak_square = 0;
+	rate_samples = 0;
+
+	// Slowest level that still meets the demand
+	int target = 0;
+	for (int i = SENSOR_RATE_LEVEL_LOW_POWER; i > 0; i--)
+	{
+		bool period_ok = peak * rate_levels[i].loop_ms <= RATE_ANGLE_BUDGET * 1000.0f;
+		bool odr_ok = rate_odr(i) >= bandwidth * RATE_OVERSAMPLE;
+		if (period_ok && odr_ok)
+		{
+			target = i;
+			break;
+		}
+	}
+	if (target < min_level)
+		target = min_level;
+
+	if (target < rate_level || min_level > rate_level) // more demand, change now
+	{
+		rate_level = target;
+		rate_hold_time = 0;
+	}
+	else if (target > rate_level) // less demand, step down after the hold time
+	{
+		if (rate_hold_time == 0)
+		{
+			rate_hold_time = time;
+		}
+		else if (time - rate_hold_time > RATE_HOLD_MS)
+		{
+			rate_level++;
+			rate_hold_time = 0;
+		}
+	}
+	else
+	{
+		rate_hold_time = 0;
+	}
+	return rate_level;
+}
+
+#else
+
+static const sensor_rate_level_t rate_levels[] = {
+	{6, 1},
+	{6, 1},
+	{6, 1},
+	{33, 1},
+	{100, 1},
+};
+
+void sensor_rate_init(void) {}
+void sensor_rate_process(const float g[3], float time) {}
+int sensor_rate_update(int min_level) { return min_level; }
+
+#endif
+
+const sensor_rate_level_t *sensor_rate_get(int level)
+{
+	return &rate_levels[level];
+}
@@ -0,0 +1,42 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2025 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#ifndef SLIMENRF_SENSOR_RATE
+#define SLIMENRF_SENSOR_RATE
+
+#include <stdint.h>
+
+typedef struct sensor_rate_level {
+	uint16_t loop_ms; // sensor loop period
+	uint8_t odr_div; // divider of the configured IMU ODR
+} sensor_rate_level_t;
+
+#define SENSOR_RATE_LEVEL_LOW_POWER 3 // slowest level selected from motion
+#define SENSOR_RATE_LEVEL_LOW_POWER_2 4
+
+/* IMU ODR and loop period are selected from the angular rate and bandwidth of the gyrometer samples */
+void sensor_rate_init(void);
+void sensor_rate_process(const float g[3], float time); // deg/s, sample time
+int sensor_rate_update(int min_level); // return level for the next loop
+const sensor_rate_level_t *sensor_rate_get(int level);
+
+#endif
@@ -29,16 +29,20 @@
 
 LOG_MODULE_REGISTER(sensor_scan, LOG_LEVEL_INF);
 
-// Any address out of range (00, 7f, etc.) will search all addresses, otherwise it will check provided address and register first
+// Probe state kept for one scan, so the full scan after a failed preferred address does not repeat bus transactions
+struct scan_probe {
+	uint8_t absent[16]; // address did not acknowledge, skip it
+	uint8_t woken[16]; // dummy read was already done
+};
 
-int sensor_scan_i2c(struct i2c_dt_spec *i2c_dev, uint8_t *i2c_dev_reg, int dev_addr_count, const uint8_t dev_addr[], const uint8_t dev_reg[], const uint8_t dev_id[], const int dev_ids[])
-{
-	if (i2c_dev->addr >= 0x7F) // ignoring device
-	{
-//		i2c_dev->addr = 0xFF; // no device found, mark as ignored
-		return -1;
-	}
+#define PROBE_TEST(map, addr) ((map)[(addr) >> 3] & BIT((addr) & 7))
+#define PROBE_SET(map, addr) ((map)[(addr) >> 3] |= BIT((addr) & 7))
+
+#define SCAN_ADDR_VALID(addr) ((addr) >= SCAN_ADDR_START && (addr) <= SCAN_ADDR_STOP)
 
+// Scan only the provided address if it is in range, otherwise all addresses, and only the provided register if set
+static int scan_i2c(struct scan_probe *probe, struct i2c_dt_spec *i2c_dev, uint8_t *i2c_dev_reg, int dev_addr_count, const uint8_t dev_addr[], const uint8_t dev_reg[], const uint8_t dev_id[], const int dev_ids[])
+{
 	const struct device *dev = i2c_dev->bus;
 
 	uint16_t addr = 0;
@@ -62,6 +66,8 @@ int sensor_scan_i2c(struct i2c_dt_spec *i2c_dev, uint8_t *i2c_dev_reg, int dev_a
 //			if (i2c_dev->addr >= SCAN_ADDR_START && i2c_dev->addr <= SCAN_ADDR_STOP && addr < i2c_dev->addr)
 			if (i2c_dev->addr >= SCAN_ADDR_START && i2c_dev->addr <= SCAN_ADDR_STOP && addr != i2c_dev->addr)
 				continue; // if an address was provided try to scan it first
+			if (PROBE_TEST(probe->absent, addr))
+				continue; // already failed during this scan
 			LOG_DBG("Scanning address: 0x%02X", addr);
 
 			// The first read on ICM-45686 can fail, so perform a dummy read on each address first
@@ -69,8 +75,12 @@ int sensor_scan_i2c(struct i2c_dt_spec *i2c_dev, uint8_t *i2c_dev_reg, int dev_a
 			 * In I2C mode, after chip power-up, the host should perform one retry
 			 * on the very first I2C transaction if it receives a NACK 
 			 */
-			uint8_t dummy;
-			i2c_reg_read_byte(dev, addr, 0x00, &dummy);
+			if (!PROBE_TEST(probe->woken, addr))
+			{
+				uint8_t dummy;
+				i2c_reg_read_byte(dev, addr, 0x00, &dummy);
+				PROBE_SET(probe->woken, addr);
+			}
 
 			int id_cnt = id_count;
 			int id_ind = id_index;
@@ -86,14 +96,20 @@ int sensor_scan_i2c(struct i2c_dt_spec *i2c_dev, uint8_t *i2c_dev_reg, int dev_a
 					{
 						int err = i2c_reg_write_byte(dev, addr, 0x4B, 0x01); // BMM150 cannot read chip id without power control enabled
 						if (err)
+						{
+							PROBE_SET(probe->absent, addr);
 							break;
+						}
 						LOG_DBG("Power up BMM150");
 						k_msleep(2); // BMM150 start-up
 					}
 					int err = i2c_reg_read_byte(dev, addr, reg, &id);
 					LOG_DBG("Read value: 0x%02X", id);
 					if (err)
+					{
+						PROBE_SET(probe->absent, addr);
 						break;
+					}
 					for (int l = 0; l < id_cnt; l++)
 					{
 						if (id == dev_id[id_ind + l])
@@ -123,15 +139,45 @@ int sensor_scan_i2c(struct i2c_dt_spec *i2c_dev, uint8_t *i2c_dev_reg, int dev_a
 			found_id += id_count;
 		}
 	}
+	return -1;
+}
+
+// Any address out of range (00, 7f, etc.) will search all addresses, otherwise it will check provided address and register first
+// Then the addresses from the board (devicetree order) are checked, before all remaining addresses
+int sensor_scan_i2c(struct i2c_dt_spec *i2c_dev, uint8_t *i2c_dev_reg, const uint8_t plan[], int plan_count, int dev_addr_count, const uint8_t dev_addr[], const uint8_t dev_reg[], const uint8_t dev_id[], const int dev_ids[])
+{
+	if (i2c_dev->addr >= 0x7F) // ignoring device
+	{
+//		i2c_dev->addr = 0xFF; // no device found, mark as ignored
+		return -1;
+	}
 
-	if ((i2c_dev->addr >= SCAN_ADDR_START && i2c_dev->addr <= SCAN_ADDR_STOP) || *i2c_dev_reg != 0xFF) // preferred address or register failed, try again with full scan
+	struct scan_probe probe = {0}; // on stack, IMU and magnetometer may be scanned in parallel
+	int id;
+	if (SCAN_ADDR_VALID(i2c_dev->addr) || *i2c_dev_reg != 0xFF) // preferred address or register
 	{
+		id = scan_i2c(&probe, i2c_dev, i2c_dev_reg, dev_addr_count, dev_addr, dev_reg, dev_id, dev_ids);
+		if (id >= 0)
+			return id;
 		LOG_WRN("No device found at address: 0x%02X", i2c_dev->addr);
-		i2c_dev->addr = 0;
 		*i2c_dev_reg = 0xFF;
-		return sensor_scan_i2c(i2c_dev, i2c_dev_reg, dev_addr_count, dev_addr, dev_reg, dev_id, dev_ids);
 	}
 
+	for (int i = 0; i < plan_count; i++)
+	{
+		if (!SCAN_ADDR_VALID(plan[i]) || PROBE_TEST(probe.absent, plan[i]))
+			continue;
+		i2c_dev->addr = plan[i];
+		id = scan_i2c(&probe, i2c_dev, i2c_dev_reg, dev_addr_count, dev_addr, dev_reg, dev_id, dev_ids);
+		if (id >= 0)
+			return id;
+	}
+
+	i2c_dev->addr = 0; // full scan, addresses that failed above are skipped
+	id = scan_i2c(&probe, i2c_dev, i2c_dev_reg, dev_addr_count, dev_addr, dev_reg, dev_id, dev_ids);
+	if (id >= 0)
+		return id;
+
 	i2c_dev->addr = 0xFF; // no device found, mark as ignored
 	return -1;
 }
@@ -30,11 +30,17 @@
 
 #include "fusion/fusions.h"
 #include "sensors.h"
+#include "imu_array.h"
+#include "range.h"
+#include "rate.h"
 
 #include "sensor.h"
 
 #define SPI_OP SPI_MODE_CPOL | SPI_MODE_CPHA | SPI_WORD_SET(8)
 
+// addresses listed in the devicetree reg property are probed in order before a full scan
+#define SENSOR_DT_REG_ADDR(i, node) DT_REG_ADDR_BY_IDX(node, i)
+
 #if DT_NODE_HAS_STATUS(DT_NODELABEL(imu_spi), okay)
 #define SENSOR_IMU_SPI_EXISTS true
 #define SENSOR_IMU_SPI_NODE DT_NODELABEL(imu_spi)
@@ -44,6 +50,7 @@ static struct spi_dt_spec sensor_imu_spi_dev = SPI_DT_SPEC_GET(SENSOR_IMU_SPI_NO
 #define SENSOR_IMU_EXISTS true
 #define SENSOR_IMU_NODE DT_NODELABEL(imu)
 static struct i2c_dt_spec sensor_imu_dev = I2C_DT_SPEC_GET(SENSOR_IMU_NODE);
+static const uint8_t sensor_imu_plan[] = {LISTIFY(DT_NUM_REGS(SENSOR_IMU_NODE), SENSOR_DT_REG_ADDR, (,), SENSOR_IMU_NODE)};
 #else
 static struct i2c_dt_spec sensor_imu_dev = {0};
 #endif
@@ -52,6 +59,23 @@ static struct i2c_dt_spec sensor_imu_dev = {0};
 #endif
 static uint8_t sensor_imu_dev_reg = 0xFF;
 
+#if CONFIG_SENSOR_USE_IMU_ARRAY // additional IMUs, must be the same model as the primary IMU
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(imu1_spi), okay)
+#define SENSOR_IMU1_SPI_EXISTS true
+static struct spi_dt_spec sensor_imu1_spi_dev = SPI_DT_SPEC_GET(DT_NODELABEL(imu1_spi), SPI_OP, 0);
+#elif DT_NODE_HAS_STATUS(DT_NODELABEL(imu1), okay)
+#define SENSOR_IMU1_EXISTS true
+static struct i2c_dt_spec sensor_imu1_dev = I2C_DT_SPEC_GET(DT_NODELABEL(imu1));
+#endif
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(imu2_spi), okay)
+#define SENSOR_IMU2_SPI_EXISTS true
+static struct spi_dt_spec sensor_imu2_spi_dev = SPI_DT_SPEC_GET(DT_NODELABEL(imu2_spi), SPI_OP, 0);
+#elif DT_NODE_HAS_STATUS(DT_NODELABEL(imu2), okay)
+#define SENSOR_IMU2_EXISTS true
+static struct i2c_dt_spec sensor_imu2_dev = I2C_DT_SPEC_GET(DT_NODELABEL(imu2));
+#endif
+#endif
+
 #if DT_NODE_HAS_STATUS(DT_NODELABEL(mag_spi), okay)
 #define SENSOR_MAG_SPI_EXISTS true
 #define SENSOR_MAG_SPI_NODE DT_NODELABEL(mag_spi)
@@ -61,6 +85,7 @@ static struct spi_dt_spec sensor_mag_spi_dev = SPI_DT_SPEC_GET(SENSOR_MAG_SPI_NO
 #define SENSOR_MAG_EXISTS true
 #define SENSOR_MAG_NODE DT_NODELABEL(mag)
 static struct i2c_dt_spec sensor_mag_dev = I2C_DT_SPEC_GET(SENSOR_MAG_NODE);
+static const uint8_t sensor_mag_plan[] = {LISTIFY(DT_NUM_REGS(SENSOR_MAG_NODE), SENSOR_DT_REG_ADDR, (,), SENSOR_MAG_NODE)};
 #else
 static struct i2c_dt_spec sensor_mag_dev = {0};
 #endif
@@ -78,11 +103,14 @@ static float last_q[4] = {1.0f, 0.0f, 0.0f, 0.0f}; // vector to hold quaternion
 static float q3[4] = {SENSOR_QUATERNION_CORRECTION}; // correction quaternion
 
 static float last_lin_a[3] = {0}; // vector to hold last linear accelerometer
+static float last_g[3] = {0}; // angular velocity at last sent orientation (deg/s)
+static float g_rate[3] = {0}; // bias corrected angular velocity of the last frame (deg/s)
 
 static int64_t last_suspend_attempt_time = 0;
 static int64_t last_data_time;
 static int64_t last_info_time;
 static int64_t last_mag_time;
+static int64_t last_send_time;
 
 static float max_gyro_speed_square;
 static bool mag_use_oneshot;
@@ -91,15 +119,52 @@ static bool mag_skip_oneshot;
 static float accel_actual_time;
 static float gyro_actual_time;
 static float mag_actual_time;
+static float mag_initial_time; // fusion magnetometer time, mag is not polled at the actual rate
 
 static bool sensor_fusion_init;
 static bool sensor_sensor_init;
 
-static bool sensor_sensor_scanning;
+enum sensor_thread_state {
+	SENSOR_THREAD_STOPPED,
+	SENSOR_THREAD_SCANNING,
+	SENSOR_THREAD_RUNNING,
+	SENSOR_THREAD_SUSPENDED,
+	SENSOR_THREAD_STOPPING,
+};
+
+// Requests to the sensor thread, handled between loop iterations
+enum sensor_thread_cmd {
+	SENSOR_THREAD_CMD_WAKEUP,
+	SENSOR_THREAD_CMD_SUSPEND,
+	SENSOR_THREAD_CMD_RESUME,
+	SENSOR_THREAD_CMD_RESTART,
+	SENSOR_THREAD_CMD_STOP,
+};
+
+struct sensor_thread_msg {
+	enum sensor_thread_cmd cmd;
+	uint32_t seq; // completion is reported for this request, 0 if nobody is waiting
+};
+
+#define SENSOR_THREAD_EVENT_IDLE BIT(0) // loop is between iterations
+#define SENSOR_THREAD_EVENT_DONE BIT(1) // a request was handled, check sensor_thread_done_seq
+
+#define SENSOR_THREAD_TIMEOUT_MS 1000
 
-static bool main_suspended;
+static enum sensor_thread_state sensor_thread_state = SENSOR_THREAD_STOPPED;
+K_MSGQ_DEFINE(sensor_thread_msgq, sizeof(struct sensor_thread_msg), 4, 4);
+static K_EVENT_DEFINE(sensor_thread_event);
+static K_MUTEX_DEFINE(sensor_thread_lock); // held by the thread making a request
+static uint32_t sensor_thread_seq; // last request sequence, with sensor_thread_lock held
+static atomic_t sensor_thread_done_seq; // last handled request
+
+static int sensor_rate_level; // current IMU ODR and loop period
+static int sensor_rate_next;
 
 static bool mag_available;
+static bool mag_ext; // magnetometer is read through IMU I2CM
+static bool mag_ext_fifo; // magnetometer data is batched in IMU FIFO
+static float mag_ext_fifo_time;
 #if MAG_ENABLED
 static bool mag_enabled = true; // TODO: toggle from server
 #else
@@ -136,7 +201,22 @@ static void sensor_loop(void);
 static struct k_thread sensor_thread_id;
 static K_THREAD_STACK_DEFINE(sensor_thread_id_stack, 1024);
 
+#if SENSOR_MAG_SPI_EXISTS || SENSOR_MAG_EXISTS
+#define SENSOR_MAG_DIRECT_EXISTS true
+// Only runs during a scan, not on sys_work_q since power off work may wait for the scan while holding sensor_thread_lock
+static struct k_thread sensor_mag_scan_thread_id;
+static K_THREAD_STACK_DEFINE(sensor_mag_scan_thread_id_stack, 1024);
+static int sensor_mag_scan_id = -1;
+#endif
+
+static uint32_t sensor_mag_scan_us;
+static uint32_t sensor_boot_scan_us;
+static uint32_t sensor_boot_init_us;
+static bool sensor_boot_logged;
+
+#if !CONFIG_CONNECTION_RECEIVER // receiver has no sensors
 K_THREAD_DEFINE(sensor_init_thread_id, 256, sensor_request_scan, true, NULL, NULL, 7, 0, 0);
+#endif
 
 const char *sensor_get_sensor_imu_name(void)
 {
@@ -163,10 +243,11 @@ void sensor_scan_thread(void)
 {
 	int err;
 	sys_interface_resume(); // make sure interfaces are enabled
+	int64_t start = k_uptime_ticks();
 	err = sensor_scan(); // IMUs discovery
 	if (err)
 	{
-		k_msleep(5);
+		k_sleep(K_TIMEOUT_ABS_TICKS(start + k_ms_to_ticks_ceil64(5))); // only wait out the rest of the POR window, the failed scan usually took longer
 		LOG_INF("Retrying sensor detection");
 
 		// Reset address before retrying sensor detection
@@ -179,15 +260,78 @@ void sensor_scan_thread(void)
 //		return err;
 }
 
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+static void sensor_scan_array_spi(struct spi_dt_spec *dev, int imu_id)
+{
+	uint8_t reg = 0xFF;
+	dev->config.frequency = MHZ(10);
+	int id = sensor_scan_imu_spi(dev, &reg);
+	if (id < 0)
+		return;
+	if (id != imu_id)
+		LOG_WRN("Additional IMU must match the primary IMU");
+	else if (sensor_interface_register_sensor_imu_aux_spi(dev) >= 0)
+		LOG_INF("Found additional %s", dev_imu_names[id]);
+}
+
+static void sensor_scan_array_i2c(struct i2c_dt_spec *dev, int imu_id)
+{
+	uint8_t reg = 0xFF;
+	uint16_t addr = dev->addr;
+	int id = sensor_scan_imu(dev, &reg, NULL, 0);
+	if (dev->addr != addr) // only the address from devicetree, a full scan would find the primary IMU
+	{
+		dev->addr = addr;
+		return;
+	}
+	if (id < 0)
+		return;
+	if (id != imu_id)
+		LOG_WRN("Additional IMU must match the primary IMU");
+	else if (sensor_interface_register_sensor_imu_aux_i2c(dev) >= 0)
+		LOG_INF("Found additional %s", dev_imu_names[id]);
+}
+#endif
+
+#if SENSOR_MAG_DIRECT_EXISTS
+static void sensor_scan_mag_direct(void)
+{
+	int64_t start = k_uptime_ticks();
+	int mag_id = -1;
+#if SENSOR_MAG_SPI_EXISTS
+	// for SPI scan, set frequency of 10MHz, it will be set later by the driver initialization if needed
+	sensor_mag_spi_dev.config.frequency = MHZ(10);
+	LOG_INF("Scanning SPI bus for magnetometer");
+	mag_id = sensor_scan_mag_spi(&sensor_mag_spi_dev, &sensor_mag_dev_reg);
+	if (mag_id >= 0)
+		sensor_interface_register_sensor_mag_spi(&sensor_mag_spi_dev);
+#endif
+#if SENSOR_MAG_EXISTS
+	if (mag_id < 0)
+	{
+		LOG_INF("Scanning bus for magnetometer");
+		mag_id = sensor_scan_mag(&sensor_mag_dev, &sensor_mag_dev_reg, sensor_mag_plan, ARRAY_SIZE(sensor_mag_plan));
+		if (mag_id >= 0)
+			sensor_interface_register_sensor_mag_i2c(&sensor_mag_dev);
+	}
+#endif
+	sensor_mag_scan_id = mag_id;
+	sensor_mag_scan_us = k_ticks_to_us_floor32(k_uptime_ticks() - start);
+}
+#endif
+
 int sensor_scan(void)
 {
-	while (sensor_sensor_scanning)
-		k_usleep(1); // already scanning
 	if (sensor_sensor_init)
 		return 0; // already initialized
-	sensor_sensor_scanning = true;
 
 	sensor_scan_read();
+	int64_t scan_start = k_uptime_ticks();
+#if SENSOR_MAG_DIRECT_EXISTS
+	// magnetometer on its own bus does not depend on the IMU, scan it at the same time
+	k_thread_create(&sensor_mag_scan_thread_id, sensor_mag_scan_thread_id_stack, K_THREAD_STACK_SIZEOF(sensor_mag_scan_thread_id_stack), (k_thread_entry_t)sensor_scan_mag_direct, NULL, NULL, NULL, 7, 0, K_NO_WAIT);
+	k_thread_name_set(&sensor_mag_scan_thread_id, "sensor_mag_scan");
+#endif
 	int imu_id = -1;
 #if SENSOR_IMU_SPI_EXISTS
 	// for SPI scan, set frequency of 10MHz, it will be set later by the driver initialization if needed
@@ -201,13 +345,17 @@ int sensor_scan(void)
 	if (imu_id < 0)
 	{
 		LOG_INF("Scanning I2C bus for IMU");
-		imu_id = sensor_scan_imu(&sensor_imu_dev, &sensor_imu_dev_reg);
+		imu_id = sensor_scan_imu(&sensor_imu_dev, &sensor_imu_dev_reg, sensor_imu_plan, ARRAY_SIZE(sensor_imu_plan));
 		if (imu_id >= 0)
 			sensor_interface_register_sensor_imu_i2c(&sensor_imu_dev);
 	}
 #endif
 #if !SENSOR_IMU_SPI_EXISTS && !SENSOR_IMU_EXISTS
 	LOG_ERR("IMU node does not exist");
+#endif
+	int64_t scan_imu = k_uptime_ticks();
+#if SENSOR_MAG_DIRECT_EXISTS
+	k_thread_join(&sensor_mag_scan_thread_id, K_FOREVER); // always wait, the thread uses the sensor data, it exits after the scan
 #endif
 	if (imu_id >= (int)ARRAY_SIZE(dev_imu_names))
 		LOG_WRN("Found unknown device");
@@ -221,7 +369,6 @@ int sensor_scan(void)
 		{
 			sensor_scan_clear(); // clear invalid sensor data
 			sensor_imu = &sensor_imu_none;
-			sensor_sensor_scanning = false; // done
 			LOG_ERR("IMU not supported");
 			set_status(SYS_STATUS_SENSOR_ERROR, true);
 			return -1; // an IMU was detected but not supported
@@ -235,28 +382,16 @@ int sensor_scan(void)
 	{
 		sensor_scan_clear(); // clear invalid sensor data
 		sensor_imu = &sensor_imu_none;
-		sensor_sensor_scanning = false; // done
 		set_status(SYS_STATUS_SENSOR_ERROR, true);
 		return -1; // no IMU detected! something is very wrong
 	}
 
 	int mag_id = -1;
-#if SENSOR_MAG_SPI_EXISTS
-	// for SPI scan, set frequency of 10MHz, it will be set later by the driver initialization if needed
-	sensor_mag_spi_dev.config.frequency = MHZ(10);
-	LOG_INF("Scanning SPI bus for magnetometer");
-	mag_id = sensor_scan_mag_spi(&sensor_mag_spi_dev, &sensor_mag_dev_reg);
-	if (mag_id >= 0)
-		sensor_interface_register_sensor_mag_spi(&sensor_mag_spi_dev);
+	mag_ext = false;
+#if SENSOR_MAG_DIRECT_EXISTS
+	mag_id = sensor_mag_scan_id;
 #endif
 #if SENSOR_MAG_EXISTS
-	if (mag_id < 0)
-	{
-		LOG_INF("Scanning bus for magnetometer");
-		mag_id = sensor_scan_mag(&sensor_mag_dev, &sensor_mag_dev_reg);
-		if (mag_id >= 0)
-			sensor_interface_register_sensor_mag_i2c(&sensor_mag_dev);
-	}
 	if (mag_id < 0 && !(sensor_imu_dev.addr & 0x80)) // I2C IMU
 	{
 		// IMU may support passthrough mode if the magnetometer is connected through the IMU
@@ -273,7 +408,7 @@ int sensor_scan(void)
 				sensor_mag_dev.addr = 0x00; // reset magnetometer data
 				sensor_mag_dev_reg = 0xFF;
 			}
-			mag_id = sensor_scan_mag(&sensor_mag_dev, &sensor_mag_dev_reg);
+			mag_id = sensor_scan_mag(&sensor_mag_dev, &sensor_mag_dev_reg, sensor_mag_plan, ARRAY_SIZE(sensor_mag_plan));
 			if (mag_id >= 0)
 			{
 				sensor_mag_dev.addr |= 0x80; // mark as external
@@ -309,6 +444,10 @@ int sensor_scan(void)
 					mag_id = -1;
 					LOG_ERR("Failed to register magnetometer external interface");
 				}
+				else
+				{
+					mag_ext = true;
+				}
 			}
 		}
 	}
@@ -342,27 +481,56 @@ int sensor_scan(void)
 		mag_available = false; // marked as not available
 	}
 
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	// scanned last, the primary IMU was already used to find the magnetometer
+#if SENSOR_IMU1_SPI_EXISTS
+	sensor_scan_array_spi(&sensor_imu1_spi_dev, imu_id);
+#elif SENSOR_IMU1_EXISTS
+	sensor_scan_array_i2c(&sensor_imu1_dev, imu_id);
+#endif
+#if SENSOR_IMU2_SPI_EXISTS
+	sensor_scan_array_spi(&sensor_imu2_spi_dev, imu_id);
+#elif SENSOR_IMU2_EXISTS
+	sensor_scan_array_i2c(&sensor_imu2_dev, imu_id);
+#endif
+#endif
+
 	sensor_scan_write();
+	sensor_boot_scan_us = k_ticks_to_us_floor32(k_uptime_ticks() - scan_start);
+	LOG_INF("Sensor scan took %uus (IMU %uus, magnetometer %uus)", sensor_boot_scan_us, k_ticks_to_us_floor32(scan_imu - scan_start), sensor_mag_scan_us);
+	sys_boot_mark(SYS_BOOT_PHASE_SCAN);
 	connection_update_sensor_ids(imu_id, mag_id);
 	sensor_imu_id = imu_id;
 	sensor_mag_id = mag_id;
 
 	sensor_sensor_init = true; // successfully initialized
-	sensor_sensor_scanning = false; // done
 	set_status(SYS_STATUS_SENSOR_ERROR, false); // clear error
 	return 0;
 }
 
-static bool main_running = false;
+static void sensor_thread_stop(void)
+{
+	if (sensor_thread_state != SENSOR_THREAD_RUNNING && sensor_thread_state != SENSOR_THREAD_SUSPENDED)
+		return;
+	struct sensor_thread_msg msg = {SENSOR_THREAD_CMD_STOP, 0};
+	k_msgq_put(&sensor_thread_msgq, &msg, K_FOREVER);
+	k_thread_join(&sensor_thread_id, K_FOREVER); // the loop returns at the end of an iteration
+	k_msgq_purge(&sensor_thread_msgq);
+	sensor_thread_state = SENSOR_THREAD_STOPPED;
+	LOG_INF("Stopped sensor thread");
+}
 
 int sensor_request_scan(bool force)
 {
 	if (sensor_sensor_init && !force)
 		return 0; // already initialized
-	main_imu_suspend();
-	k_thread_abort(&sensor_thread_id); // stop the sensor thread // TODO: may need to handle fusion state
-	LOG_INF("Aborted sensor thread");
-	main_suspended = false;
+	k_mutex_lock(&sensor_thread_lock, K_FOREVER);
+	if (sensor_sensor_init && !force)
+	{
+		k_mutex_unlock(&sensor_thread_lock);
+		return 0; // initialized while waiting
+	}
+	sensor_thread_stop(); // TODO: may need to handle fusion state
 	sensor_sensor_init = false;
 	if (force)
 	{
@@ -372,14 +540,22 @@ int sensor_request_scan(bool force)
 		sensor_mag_dev_reg = 0xFF;
 		LOG_INF("Requested sensor scan");
 	}
+	sensor_thread_state = SENSOR_THREAD_SCANNING;
 	k_thread_create(&sensor_thread_id, sensor_thread_id_stack, K_THREAD_STACK_SIZEOF(sensor_thread_id_stack), (k_thread_entry_t)sensor_scan_thread, NULL, NULL, NULL, 7, 0, K_NO_WAIT);
+	k_thread_name_set(&sensor_thread_id, "sensor_scan");
 	k_thread_join(&sensor_thread_id, K_FOREVER); // wait for the thread to finish
+	sensor_thread_state = SENSOR_THREAD_STOPPED;
 	if (sensor_sensor_init && force)
-	{		
+	{
+		k_event_clear(&sensor_thread_event, SENSOR_THREAD_EVENT_IDLE);
+		sensor_thread_state = SENSOR_THREAD_RUNNING;
 		k_thread_create(&sensor_thread_id, sensor_thread_id_stack, K_THREAD_STACK_SIZEOF(sensor_thread_id_stack), (k_thread_entry_t)sensor_loop, NULL, NULL, NULL, 7, 0, K_NO_WAIT);
+		k_thread_name_set(&sensor_thread_id, "sensor_loop");
 		LOG_INF("Started sensor loop");
 	}
-	return !sensor_sensor_init;
+	int err = !sensor_sensor_init;
+	k_mutex_unlock(&sensor_thread_lock);
+	return err;
 }
 
 void sensor_scan_read(void) // TODO: move some of this to sys?
@@ -404,7 +580,7 @@ void sensor_scan_write(void) // TODO: move some of this to sys?
 	retained->mag_addr = sensor_mag_dev.addr;
 	retained->imu_reg = sensor_imu_dev_reg;
 	retained->mag_reg = sensor_mag_dev_reg;
-	retained_update();
+	retained_update_section(RETAINED_SECTION_SCAN);
 }
 
 void sensor_scan_clear(void) // TODO: move some of this to sys?
@@ -413,7 +589,7 @@ void sensor_scan_clear(void) // TODO: move some of this to sys?
 	retained->mag_addr = 0x00;
 	retained->imu_reg = 0xFF;
 	retained->mag_reg = 0xFF;
-	retained_update();
+	retained_update_section(RETAINED_SECTION_SCAN);
 }
 
 void sensor_retained_read(void) // TODO: move some of this to sys? or move to calibration?
@@ -442,9 +618,9 @@ void sensor_retained_write(void) // TODO: move to sys?
 	if (!sensor_fusion_init)
 		return;
 //	memcpy(retained->magBias, sensor_calibration_get_magBias(), sizeof(retained->magBias));
-	sensor_fusion->save(retained->fusion_data);
+	sensor_fusion->save(&retained->fusion_state);
 	retained->fusion_id = fusion_id;
-	retained_update();
+	retained_update_section(RETAINED_SECTION_FUSION);
 }
 
 void sensor_shutdown(void) // Communicate all imus to shut down
@@ -494,7 +670,7 @@ void sensor_fusion_invalidate(void)
 	else
 	{ // TODO: always clearing the fusion?
 		retained->fusion_id = 0; // Invalidate retained fusion data
-		retained_update();
+		retained_update_section(RETAINED_SECTION_FUSION);
 	}
 }
 
@@ -506,6 +682,56 @@ static void set_update_time_ms(int time_ms)
 	sensor_update_time_ms = time_ms; // TODO: terrible naming
 }
 
+// Let the IMU read the magnetometer by itself and batch the data in FIFO
+// Any magnetometer configuration through I2CM stops the IMU, so this is set again after
+static void sensor_mag_ext_fifo_setup(void)
+{
+	mag_ext_fifo = false;
+	if (!mag_ext || !mag_available || !mag_enabled || mag_actual_time == INFINITY)
+		return;
+	uint8_t addr = sensor_mag_dev.addr & 0x7F;
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	sensor_interface_imu_select(0); // magnetometer is on the primary IMU
+#endif
+	int err = sensor_imu->ext_fifo_setup(addr, sensor_mag->ext_data_reg, sensor_mag->ext_burst, mag_actual_time, &mag_ext_fifo_time);
+	if (err)
+		err = sensor_imu->ext_fifo_setup(addr, sensor_mag->ext_data_reg, sensor_mag->ext_min_burst, mag_actual_time, &mag_ext_fifo_time);
+#if CONFIG_SENSOR_USE_IMU_ARRAY
+	sensor_interface_imu_select(-1);
+#endif
+	if (!err)
+	{
+		LOG_DBG("Magnetometer batched in FIFO at %.2fHz", 1.0 / (double)mag_ext_fifo_time);
+		mag_ext_fifo = true;
+		mag_skip_oneshot = true; // IMU can only read continuous mode
+	}
+}
+
+static void sensor_process_mag(float raw_m[3], float time)
+{
+	bool mag_calibrated = true;
+	float uncalibrated_m[3] = {0};
+	memcpy(uncalibrated_m, raw_m, sizeof(uncalibrated_m)); // copy raw magnetometer data
+	sensor_calibration_process_mag(raw_m);
+	float zero_m[3] = {0};
+	if (v_epsilon(raw_m, zero_m, 1e-6)) // if the magnetometer is not calibrated, skip and send raw data
+	{
+		memcpy(raw_m, uncalibrated_m, sizeof(uncalibrated_m));
+		mag_calibrated = false;
+	}
+	float mx = raw_m[0];
+	float my = raw_m[1];
+	float mz = raw_m[2];
+	float m[] = {SENSOR_MAGNETOMETER_AXES_ALIGNMENT};
+
+	// Process fusion
+	if (mag_calibrated)
+		sensor_fusion->update_mag(m, time);
+
+	v_rotate(m, q3, m); // magnetic field in local device frame, no other transformation will be done
+	connection_update_sensor_mag(m);
+}
+
 int sensor_init(void)
 {
 	int err;
@@ -531,11 +757,13 @@ int sensor_init(void)
 	sensor_imu->update_fs(accel_range, gyro_range, &accel_actual_range, &gyro_actual_range);
 	LOG_INF("Accelerometer range: %.2fg", (double)accel_actual_range);
 	LOG_INF("Gyroscope range: %.2fdps", (double)gyro_actual_range);
+	sensor_array_init(sensor_imu, accel_actual_range, gyro_actual_range);
+	sensor_range_init(sensor_imu, accel_actual_range, gyro_actual_range);
 
 	// setup sensor, set ODR
 	float accel_initial_time = 1.0 / CONFIG_SENSOR_ACCEL_ODR; // configure with ~1000Hz ODR
 	float gyro_initial_time = 1.0 / CONFIG_SENSOR_GYRO_ODR; // configure with ~1000Hz ODR
-	float mag_initial_time = sensor_update_time_ms / 1000.0; // configure with ~200Hz ODR
+	mag_initial_time = sensor_update_time_ms / 1000.0; // configure with ~200Hz ODR
 	err = sensor_imu->init(clock_actual_rate, accel_initial_time, gyro_initial_time, &accel_actual_time, &gyro_actual_time);
 #if SENSOR_IMU_SPI_EXISTS
 	LOG_INF("Requested SPI frequency: %.2fMHz", (double)sensor_imu_spi_dev.config.frequency / 1000000.0);
@@ -556,6 +784,7 @@ int sensor_init(void)
 		LOG_INF("Magnetometer initial rate: %.2fHz", 1.0 / (double)mag_actual_time);
 		if (err < 0)
 			return err;
+		sensor_mag_ext_fifo_setup();
 // 0-1ms to setup mmc
 	}
 	LOG_INF("Initialized sensors");
@@ -564,15 +793,13 @@ int sensor_init(void)
 	sensor_retained_read(); // TODO: useless
 	if (fusion_id == FUSION_VQF)
 		vqf_update_sensor_ids(sensor_imu_id);
+	sensor_fusion->init(gyro_actual_time, accel_actual_time, mag_initial_time); // TODO: using initial time since mag are not polled at the actual rate
 	if (retained->fusion_id == fusion_id) // Check if the retained fusion data is valid and matches the selected fusion
 	{ // Load state if the data is valid (fusion was initialized before)
-		sensor_fusion->load(retained->fusion_data);
+		sensor_fusion->load(&retained->fusion_state);
+		LOG_INF("Restored fusion state, gyro bias: %.2f %.2f %.2f", (double)retained->fusion_state.gyro_bias[0], (double)retained->fusion_state.gyro_bias[1], (double)retained->fusion_state.gyro_bias[2]);
 		retained->fusion_id = 0; // Invalidate retained fusion data
-		retained_update();
-	}
-	else
-	{
-		sensor_fusion->init(gyro_actual_time, accel_actual_time, mag_initial_time); // TODO: using initial time since mag are not polled at the actual rate
+		retained_update_section(RETAINED_SECTION_FUSION);
 	}
 
 	sensor_calibration_update_sensor_ids(sensor_imu_id);
@@ -584,6 +811,9 @@ int sensor_init(void)
 
 	LOG_INF("Using %s", fusion_names[fusion_id]);
 	LOG_INF("Initialized fusion");
+	sensor_rate_init();
+	sensor_rate_level = 0; // configured ODR
+	sensor_rate_next = 0;
 	sensor_fusion_init = true;
 	return 0;
 }
@@ -595,6 +825,12 @@ enum sensor_sensor_mode {
 	SENSOR_SENSOR_MODE_LOW_POWER_2
 };
 
+static const enum sys_sleep_state sensor_sleep_states[] = {
+	[SENSOR_SENSOR_MODE_LOW_NOISE] = SYS_SLEEP_STATE_LOW_NOISE,
+	[SENSOR_SENSOR_MODE_LOW_POWER] = SYS_SLEEP_STATE_LOW_POWER,
+	[SENSOR_SENSOR_MODE_LOW_POWER_2] = SYS_SLEEP_STATE_LOW_POWER_2,
+};
+
 static enum sensor_sensor_mode sensor_mode = SENSOR_SENSOR_MODE_LOW_NOISE;
 static enum sensor_sensor_mode last_sensor_mode = SENSOR_SENSOR_MODE_LOW_NOISE;
 
@@ -609,13 +845,16 @@ static enum sensor_sensor_timeout sensor_timeout = SENSOR_SENSOR_TIMEOUT_IMU;
 
 static bool main_ok = false;
 static bool send_info = false;
+static bool send_status = false;
 
 static int packet_errors = 0;
 
 #define ACQUISITION_START_MS 1000
 #define STATUS_INTERVAL_MS 5000
+#define TEMP_INTERVAL_MS 100
 
 static int64_t last_status_time = 0;
+static int64_t last_temp_time = 0;
 static int64_t max_loop_time = 0;
 
 #if DEBUG
@@ -627,22 +866,85 @@ static uint64_t total_gyro_samples = 0;
 static uint64_t total_accel_samples = 0;
 #endif
 
+static void sensor_fusion_restart(void)
+{
+	if (main_ok) // only restart fusion if initialized
+		sensor_fusion->init(gyro_actual_time, accel_actual_time, 6 / 1000.0f); // TODO: using default initial time
+}
+
+// Wait until the next loop iteration while handling requests, returns true if the thread should stop
+static bool sensor_thread_wait(k_timeout_t timeout)
+{
+	k_timepoint_t end = sys_timepoint_calc(timeout);
+	struct sensor_thread_msg msg;
+	k_event_post(&sensor_thread_event, SENSOR_THREAD_EVENT_IDLE);
+	while (k_msgq_get(&sensor_thread_msgq, &msg, sensor_thread_state == SENSOR_THREAD_SUSPENDED ? K_FOREVER : sys_timepoint_timeout(end)) == 0)
+	{
+		switch (msg.cmd)
+		{
+		case SENSOR_THREAD_CMD_WAKEUP:
+			if (sensor_thread_state == SENSOR_THREAD_RUNNING)
+				end = sys_timepoint_calc(K_NO_WAIT);
+			break;
+		case SENSOR_THREAD_CMD_SUSPEND:
+			sensor_thread_state = SENSOR_THREAD_SUSPENDED;
+			sys_sleep_set_anchor(0, 0);
+			sys_sleep_set_state(SYS_SLEEP_STATE_SUSPENDED);
+			break;
+		case SENSOR_THREAD_CMD_RESUME:
+			if (sensor_thread_state == SENSOR_THREAD_SUSPENDED)
+			{
+				sensor_thread_state = SENSOR_THREAD_RUNNING;
+				sys_sleep_set_state(sensor_sleep_states[sensor_mode]);
+				end = sys_timepoint_calc(K_NO_WAIT);
+			}
+			break;
+		case SENSOR_THREAD_CMD_RESTART:
+			sensor_fusion_restart();
+			break;
+		case SENSOR_THREAD_CMD_STOP:
+			sensor_thread_state = SENSOR_THREAD_STOPPING;
+			sys_sleep_set_anchor(0, 0);
+			sys_sleep_set_state(SYS_SLEEP_STATE_SUSPENDED);
+			return true;
+		}
+		if (msg.seq != 0)
+		{
+			atomic_set(&sensor_thread_done_seq, msg.seq);
+			k_event_post(&sensor_thread_event, SENSOR_THREAD_EVENT_DONE);
+		}
+	}
+	k_event_clear(&sensor_thread_event, SENSOR_THREAD_EVENT_IDLE);
+	return false;
+}
+
 void sensor_loop(void)
 {
 	if (!sensor_sensor_init)
 		return;
-	main_running = true;
 	sys_interface_resume(); // make sure interfaces are enabled
+	int64_t init_start = k_uptime_ticks();
 	int err = sensor_init(); // Initialize IMUs and Fusion // TODO: run as thread before loop
+	sensor_boot_init_us = k_ticks_to_us_floor32(k_uptime_ticks() - init_start);
+	sys_interface_suspend();
 	// TODO: handle imu init error, maybe restart device?
 	// TODO: on failure to init, disable sensor interface
 	if (err)
+	{
 		set_status(SYS_STATUS_SENSOR_ERROR, true); // TODO: only handles general init error
+	}
 	else
+	{
 		main_ok = true;
+		sys_boot_mark(SYS_BOOT_PHASE_SENSOR);
+		sys_sleep_set_state(sensor_sleep_states[sensor_mode]);
+		if (sys_boot_fast_resume()) // start the radio clock while the first samples are read
+			connection_clocks_request_start();
+	}
 	while (1)
 	{
 		int64_t time_begin = k_uptime_get();
+		int64_t tick_begin = k_uptime_ticks();
 		if (main_ok)
 		{
 			// Resume devices
@@ -651,6 +953,8 @@ void sensor_loop(void)
 			// Trigger reconfig on sensor mode change
 			bool reconfig = last_sensor_mode != sensor_mode;
 			last_sensor_mode = sensor_mode;
+			if (reconfig)
+				sys_sleep_set_state(sensor_sleep_states[sensor_mode]);
 
 			// Reading IMUs will take between 2.5ms (~7 samples, low noise) - 7ms (~33 samples, low power)
 			// Magneto sample will take ~400us
@@ -658,15 +962,23 @@ void sensor_loop(void)
 			// TODO: on any errors set main_ok false and skip (make functions return nonzero)
 
 			// At high speed, use oneshot mode to have synced magnetometer data
-			// Call before FIFO and get the data after
-			if (mag_available && mag_enabled && mag_use_oneshot)
+			// Trigger before FIFO and get the data after fusion, the conversion runs during the FIFO read and fusion
+			bool mag_oneshot = mag_available && mag_enabled && mag_use_oneshot;
+			if (mag_oneshot)
 				sensor_mag->mag_oneshot();
 
-			// Read IMU temperature
-			float temp = sensor_imu->temp_read(); // TODO: use as calibration data
-			connection_update_sensor_temp(temp);
+			// Read IMU temperature, only sent about every 100ms
+			// Drivers with temperature in the FIFO return the last value without a bus transaction
+			if (k_uptime_get() - last_temp_time >= TEMP_INTERVAL_MS)
+			{
+				float temp = sensor_imu->temp_read(); // TODO: use as calibration data
+				connection_update_sensor_temp(temp);
+				last_temp_time = k_uptime_get();
+			}
 
 			// Read gyroscope (FIFO)
+			// Newest sample in the FIFO was captured up to one sample period before the read, use the mean age
+			int64_t fifo_time = k_uptime_ticks() - k_us_to_ticks_floor64((uint64_t)(gyro_actual_time * 1000000.0f) / 2);
 #if CONFIG_SENSOR_USE_LOW_POWER_2
 			uint8_t* rawData = (uint8_t*)k_malloc(1900);  // Limit FIFO read to 2048 bytes (worst case is ICM 20 byte packet at 1000Hz and 100ms update time)
 			if (rawData == NULL)
@@ -676,6 +988,7 @@ void sensor_loop(void)
 				main_ok = false;
 			}
 			uint16_t packets = sensor_imu->fifo_read(rawData, 1900); // TODO: name this better?
+			sensor_array_read(1900);
 #else
 			uint8_t* rawData = (uint8_t*)k_malloc(1024);  // Limit FIFO read to 768 bytes (worst case is ICM 20 byte packet at 1000Hz and 33ms update time)
 			if (rawData == NULL)
@@ -685,7 +998,34 @@ void sensor_loop(void)
 				main_ok = false;
 			}
 			uint16_t packets = sensor_imu->fifo_read(rawData, 1024); // TODO: name this better?
+			sensor_array_read(1024);
 #endif
+			sensor_range_apply(accel_actual_time, gyro_actual_time); // change range at the FIFO boundary
+
+			// Change IMU ODR and loop period at the FIFO boundary, samples already read use the previous rate
+			float next_accel_time = accel_actual_time;
+			float next_gyro_time = gyro_actual_time;
+			bool rate_changed = false;
+			if (sensor_rate_next != sensor_rate_level)
+			{
+				const sensor_rate_level_t *level = sensor_rate_get(sensor_rate_next);
+				float accel_time = (float)level->odr_div / CONFIG_SENSOR_ACCEL_ODR;
+				float gyro_time = (float)level->odr_div / CONFIG_SENSOR_GYRO_ODR;
+				int err = sensor_imu->update_odr(accel_time, gyro_time, &next_accel_time, &next_gyro_time);
+				if (err < 0)
+				{
+					next_accel_time = accel_actual_time;
+					next_gyro_time = gyro_actual_time;
+				}
+				rate_changed = !err;
+				if (rate_changed)
+				{
+					LOG_DBG("Switching IMU rate to %.2fHz, update time to %dms", 1.0 / (double)next_gyro_time, level->loop_ms);
+					sensor_mag_ext_fifo_setup(); // IMU ODR may pace the magnetometer reads
+				}
+				set_update_time_ms(level->loop_ms);
+				sensor_rate_level = sensor_rate_next;
+			}
 
 			// Debug info
 #if DEBUG
@@ -699,9 +1039,9 @@ void sensor_loop(void)
 			last_acquisition_time = acquisition_time;
 #endif
 
-			// Read magnetometer
+			// Read magnetometer, oneshot measurement is read after fusion
 			float raw_m[3];
-			if (mag_available && mag_enabled)
+			if (mag_available && mag_enabled && !mag_ext_fifo && !mag_oneshot)
 				sensor_mag->mag_read(raw_m); // reading mag last, and it will be processed last
 
 			if (reconfig) // TODO: get rid of reconfig?
@@ -709,15 +1049,12 @@ void sensor_loop(void)
 				switch (sensor_mode)
 				{
 				case SENSOR_SENSOR_MODE_LOW_NOISE:
-					set_update_time_ms(6);
 					LOG_INF("Switching sensors to low noise");
 					break;
 				case SENSOR_SENSOR_MODE_LOW_POWER:
-					set_update_time_ms(33);
 					LOG_INF("Switching sensors to low power");
 					break;
 				case SENSOR_SENSOR_MODE_LOW_POWER_2:
-					set_update_time_ms(100);
 					LOG_INF("Switching sensors to low power 2");
 					break;
 				};
@@ -729,14 +1066,31 @@ void sensor_loop(void)
 			// Fuse all data
 			float a_sum[3] = {0};
 			int a_count = 0;
+			float g_sum[3] = {0};
+			int g_count = 0;
 			max_gyro_speed_square = 0;
 			int processed_packets = 0;
-			for (uint16_t i = 0; i < packets; i++) // TODO: fifo_process_ext is available, need to implement it
+			sensor_array_begin(rawData, packets);
+			for (uint16_t i = 0; i < packets; i++)
 			{
 				float raw_a[3] = {0};
 				float raw_g[3] = {0};
+				if (mag_ext_fifo)
+				{
+					uint8_t raw_ext[9] = {0}; // largest magnetometer burst
+					if (!sensor_imu->fifo_process_ext(i, rawData, raw_ext))
+					{
+						// Process magnetometer in order with the other samples
+						sensor_mag->mag_process(raw_ext, raw_m);
+						sensor_process_mag(raw_m, mag_ext_fifo_time);
+						processed_packets++;
+						continue;
+					}
+				}
 				if (sensor_imu->fifo_process(i, rawData, raw_a, raw_g))
 					continue; // skip on error
+				sensor_range_process(raw_a, raw_g); // before merging, saturation is checked on samples at the range they were captured at
+				sensor_array_process(raw_a, raw_g); // merge additional IMUs
 
 				// TODO: split into separate functions
 				if (raw_g[0] != 0 || raw_g[1] != 0 || raw_g[2] != 0)
@@ -754,14 +1108,20 @@ void sensor_loop(void)
 #if CONFIG_SENSOR_USE_SENS_CALIBRATION					
 					// Apply sensitivity scaling
 					if (retained) {
-						g[0] *= retained->gyroSensScale[0];
-						g[1] *= retained->gyroSensScale[1];
-						g[2] *= retained->gyroSensScale[2];
+						int sens = sensor_range_sens_index();
+						g[0] *= retained->gyroSensScale[sens][0];
+						g[1] *= retained->gyroSensScale[sens][1];
+						g[2] *= retained->gyroSensScale[sens][2];
 					}
 #endif	
 	
 					// Process fusion
 					sensor_fusion->update_gyro(g, gyro_actual_time);
+					sensor_rate_process(g, gyro_actual_time);
+
+					for (int i = 0; i < 3; i++)
+						g_sum[i] += g[i];
+					g_count++;
 
 					if (mag_available && mag_enabled)
 					{
@@ -803,36 +1163,29 @@ void sensor_loop(void)
 
 			// Free the FIFO buffer
 			k_free(rawData);
+			sensor_array_end(packets);
+			sensor_range_update();
+
+			if (rate_changed) // following samples use the new rate
+			{
+				accel_actual_time = next_accel_time;
+				gyro_actual_time = next_gyro_time;
+				sensor_fusion->update_rate(gyro_actual_time, accel_actual_time, mag_initial_time); // same magnetometer time as init
+			}
 
 #if DEBUG
 			if (valid_acquisition)
 				total_processed_packets += processed_packets;
 #endif
 
-			if (mag_available && mag_enabled)
+			if (mag_oneshot && !mag_ext_fifo)
 			{
-				bool mag_calibrated = true;
-				float uncalibrated_m[3] = {0};
-				memcpy(uncalibrated_m, raw_m, sizeof(uncalibrated_m)); // copy raw magnetometer data
-				sensor_calibration_process_mag(raw_m);
-				float zero_m[3] = {0};
-				if (v_epsilon(raw_m, zero_m, 1e-6)) // if the magnetometer is not calibrated, skip and send raw data
-				{
-					memcpy(raw_m, uncalibrated_m, sizeof(uncalibrated_m));
-					mag_calibrated = false;
-				}
-				float mx = raw_m[0];
-				float my = raw_m[1];
-				float mz = raw_m[2];
-				float m[] = {SENSOR_MAGNETOMETER_AXES_ALIGNMENT};
-
-				// Process fusion
-				if (mag_calibrated)
-					sensor_fusion->update_mag(m, sensor_update_time_ms / 1000.0); // TODO: use actual time?
-
-				v_rotate(m, q3, m); // magnetic field in local device frame, no other transformation will be done
-				connection_update_sensor_mag(m);
+				sys_interface_resume();
+				sensor_mag->mag_read(raw_m); // conversion was started before the FIFO read, the driver still polls its status register and normally finds it ready
+				sys_interface_suspend();
 			}
+			if (mag_available && mag_enabled && !mag_ext_fifo)
+				sensor_process_mag(raw_m, sensor_update_time_ms / 1000.0); // TODO: use actual time?
 
 			// Copy average acceleration for this frame
 			static float a[3] = {0}; // keep persistent
@@ -842,6 +1195,15 @@ void sensor_loop(void)
 					a[i] = a_sum[i] / a_count;
 			}
 
+			// Copy average angular velocity for this frame, used to predict the orientation between packets
+			if (g_count > 0)
+			{
+				float g_off[3] = {0};
+				sensor_fusion->get_gyro_bias(g_off);
+				for (int i = 0; i < 3; i++)
+					g_rate[i] = g_sum[i] / g_count - g_off[i];
+			}
+
 			// Check packet processing
 			if ((packets != 0 || k_uptime_get() > 100) && processed_packets == 0)
 			{
@@ -871,6 +1233,12 @@ void sensor_loop(void)
 			// Get updated quaternion from fusion
 			sensor_fusion->get_quat(q);
 			q_normalize(q, q); // safe to use self as output
+			if (!sensor_boot_logged && processed_packets > 0)
+			{
+				LOG_INF("First orientation at %lldms (scan %uus, init %uus)", k_uptime_get(), sensor_boot_scan_us, sensor_boot_init_us);
+				sensor_boot_logged = true;
+				sys_boot_mark(SYS_BOOT_PHASE_ORIENTATION);
+			}
 
 			// Get linear acceleration // TODO: move to util functions
 			float lin_a[3] = {0};
@@ -915,7 +1283,6 @@ void sensor_loop(void)
 					sys_request_WOM(true); // TODO: should queue shutdown and suspend itself instead
 //					main_imu_suspend(); // TODO: auto suspend, the device should configure WOM ASAP but it does not
 #elif CONFIG_SHUTDOWN_ON_ACTIVE_TIMEOUT && CONFIG_USER_SHUTDOWN
-					main_running = false; // skip suspend step, at the moment the thread must be running to shutdown // TODO: should queue shutdown and suspend itself instead
 					sys_request_system_off();
 #endif
 					sensor_timeout = SENSOR_SENSOR_TIMEOUT_ACTIVITY_ELAPSED; // only try to suspend once
@@ -941,6 +1308,14 @@ void sensor_loop(void)
 				sensor_mode = SENSOR_SENSOR_MODE_LOW_NOISE;
 			}
 
+			// Select IMU ODR and loop period for the next loop, low power modes set the slowest allowed level
+			int rate_min_level = 0;
+			if (sensor_mode == SENSOR_SENSOR_MODE_LOW_POWER)
+				rate_min_level = SENSOR_RATE_LEVEL_LOW_POWER;
+			else if (sensor_mode == SENSOR_SENSOR_MODE_LOW_POWER_2)
+				rate_min_level = SENSOR_RATE_LEVEL_LOW_POWER_2;
+			sensor_rate_next = sensor_rate_update(rate_min_level);
+
 			// Update magnetometer mode
 			if (mag_available && mag_enabled)
 			{
@@ -970,9 +1345,12 @@ void sensor_loop(void)
 				if (mag_target_time >= 0.005f || mag_actual_time != INFINITY) // under 200Hz or magnetometer did not have a oneshot mode
 				{
 					int err = sensor_mag->update_odr(mag_target_time, &mag_actual_time);
+					mag_use_oneshot = false;
 					if (!err)
+					{
 						LOG_DBG("Switching magnetometer ODR to %.2fHz", 1.0 / (double)mag_actual_time);
-					mag_use_oneshot = false;
+						sensor_mag_ext_fifo_setup(); // restart batching at the new rate
+					}
 				}
 				sys_interface_suspend();
 			}
@@ -984,18 +1362,33 @@ void sensor_loop(void)
 				last_info_time = k_uptime_get();
 			}
 
-			// Send packet with new orientation
-			bool send_quat_data = !q_epsilon(q, last_q, 0.001);
+			// Predict the orientation the receiver is showing since the last packet
+			int64_t send_delta = k_uptime_get() - last_send_time;
+			float q_pred[4];
+#if CONFIG_SENSOR_USE_PREDICTED_SEND
+			float q_delta[4];
+			q_from_gyro(last_g, send_delta / 1000.0f, q_delta); // constant angular velocity from the last packet
+			q_multiply(last_q, q_delta, q_pred);
+#else
+			memcpy(q_pred, last_q, sizeof(q_pred)); // last packet is held
+#endif
+
+			// Send packet with new orientation if the predicted error is too large, or if the last packet is too old
+			float send_error = q_diff_mag(q, q_pred) * (180.0f / M_PI) * 1000.0f; // mdeg
+			bool send_quat_data = send_error > CONFIG_SENSOR_SEND_ERROR_BOUND || send_delta > CONFIG_SENSOR_SEND_MAX_INTERVAL;
 			bool send_lin_accel_data = !v_epsilon(lin_a, last_lin_a, 0.05);
 			if (send_quat_data || send_lin_accel_data)
 			{
 				bool send_precise_quat = q_epsilon(q, last_q, 0.005);
 				memcpy(last_q, q, sizeof(q));
 				memcpy(last_lin_a, lin_a, sizeof(lin_a));
+				memcpy(last_g, g_rate, sizeof(g_rate));
+				last_send_time = k_uptime_get();
 				float q_offset[4];
 				q_multiply(q, q3, q_offset); // quaternion in device orientation, connection will change format from wxyz to xyzw
 				v_rotate(lin_a, q3, lin_a); // linear acceleration in local device frame, no other transformation will be done
 				connection_update_sensor_data(q_offset, lin_a);
+				connection_update_sensor_timestamp(fifo_time);
 				if (send_info && !send_precise_quat) // prioritize quat precision
 				{
 					connection_write_packet_2();
@@ -1006,11 +1399,24 @@ void sensor_loop(void)
 					connection_write_packet_4();
 					last_mag_time = k_uptime_get();
 				}
+#if CONFIG_CONNECTION_USE_TIMESTAMP
+				else if (!send_precise_quat) // timestamp during motion
+				{
+					connection_write_packet_5();
+				}
+#endif
 				else
 				{
 					connection_write_packet_1();
 				}
 			}
+#if CONFIG_CONNECTION_USE_MEM_STATS
+			else if (send_status)
+			{
+				connection_write_packet_3();
+				send_status = false;
+			}
+#endif
 			else if (send_info)
 			{
 				connection_write_packet_0();
@@ -1026,7 +1432,6 @@ void sensor_loop(void)
 				sensor_request_calibration_mag();
 		}
 
-		main_running = false;
 		int64_t time_delta = k_uptime_get() - time_begin;
 
 		if (time_delta > sensor_update_time_ms && time_delta > max_loop_time)
@@ -1035,6 +1440,7 @@ void sensor_loop(void)
 		if (k_uptime_get() - last_status_time > STATUS_INTERVAL_MS)
 		{
 			last_status_time = k_uptime_get();
+			send_status = true; // only sent with memory statistics
 			if (max_loop_time > 0)
 			{
 				LOG_WRN("Last update steps took up to %lld ms", time_delta);
@@ -1047,53 +1453,87 @@ void sensor_loop(void)
 		}
 
 //		led_clock_offset += time_delta;
+		// Wake on a fixed period from the start of this iteration, periodic system work is aligned to the same ticks
+		int64_t next_wake = tick_begin + k_ms_to_ticks_ceil64(sensor_update_time_ms);
+		sys_sleep_set_anchor(next_wake, k_ms_to_ticks_ceil32(sensor_update_time_ms));
 		if (time_delta > sensor_update_time_ms)
 			k_yield();
-		else
-			k_msleep(sensor_update_time_ms - time_delta);
-
-		if (main_suspended) // TODO:
-			k_thread_suspend(&sensor_thread_id);
+		if (sensor_thread_wait(time_delta > sensor_update_time_ms ? K_NO_WAIT : K_TIMEOUT_ABS_TICKS(next_wake)))
+			return; // stop requested
+	}
+}
 
-		main_running = true;
+// Send a request to the sensor thread and wait for it to be handled, call with sensor_thread_lock held
+static int sensor_thread_request(enum sensor_thread_cmd cmd)
+{
+	if (++sensor_thread_seq == 0)
+		sensor_thread_seq = 1; // 0 is not acknowledged
+	struct sensor_thread_msg msg = {cmd, sensor_thread_seq};
+	k_timepoint_t end = sys_timepoint_calc(K_MSEC(SENSOR_THREAD_TIMEOUT_MS));
+	k_event_clear(&sensor_thread_event, SENSOR_THREAD_EVENT_DONE);
+	k_msgq_put(&sensor_thread_msgq, &msg, K_FOREVER);
+	while ((uint32_t)atomic_get(&sensor_thread_done_seq) != msg.seq) // only this request, other commands may be handled first
+	{
+		if (!k_event_wait(&sensor_thread_event, SENSOR_THREAD_EVENT_DONE, false, sys_timepoint_timeout(end)))
+		{
+			LOG_ERR("Sensor thread did not respond");
+			return -ETIMEDOUT;
+		}
+		k_event_clear(&sensor_thread_event, SENSOR_THREAD_EVENT_DONE);
 	}
+	return 0;
 }
 
-void wait_for_threads(void) // TODO: add timeout
+void wait_for_threads(void)
 {
-	while (main_running)
-		k_usleep(1); // bane of my existence. don't use k_yield()!!!!!!
+	if (k_current_get() == &sensor_thread_id || sensor_thread_state != SENSOR_THREAD_RUNNING)
+		return;
+	if (!k_event_wait(&sensor_thread_event, SENSOR_THREAD_EVENT_IDLE, false, K_MSEC(SENSOR_THREAD_TIMEOUT_MS)))
+		LOG_ERR("Sensor thread did not respond");
 }
 
-void main_imu_suspend(void) // TODO: add timeout
+void main_imu_suspend(void)
 {
-	main_suspended = true;
-	if (!main_running) // don't suspend if already stopped (TODO: may be called from sensor thread)
+	if (k_current_get() == &sensor_thread_id)
+	{
+		struct sensor_thread_msg msg = {SENSOR_THREAD_CMD_SUSPEND, 0};
+		k_msgq_put(&sensor_thread_msgq, &msg, K_NO_WAIT); // suspends itself after this iteration
 		return;
-	while (sensor_sensor_scanning)
-		k_usleep(1); // try not to interrupt scanning
-	while (main_running) // TODO: change to detect if i2c is busy
-		k_usleep(1); // try not to interrupt anything actually
-	k_thread_suspend(&sensor_thread_id);
-	LOG_INF("Suspended sensor thread");
+	}
+	k_mutex_lock(&sensor_thread_lock, K_FOREVER); // also waits for scanning to finish
+	if (sensor_thread_state == SENSOR_THREAD_RUNNING && !sensor_thread_request(SENSOR_THREAD_CMD_SUSPEND))
+		LOG_INF("Suspended sensor thread");
+	k_mutex_unlock(&sensor_thread_lock);
 }
 
 void main_imu_resume(void)
 {
-	if (!main_suspended) // not suspended
+	if (k_current_get() == &sensor_thread_id)
 		return;
-	k_thread_resume(&sensor_thread_id);
-	LOG_INF("Resumed sensor thread");
+	k_mutex_lock(&sensor_thread_lock, K_FOREVER);
+	if (sensor_thread_state == SENSOR_THREAD_SUSPENDED && !sensor_thread_request(SENSOR_THREAD_CMD_RESUME))
+		LOG_INF("Resumed sensor thread");
+	k_mutex_unlock(&sensor_thread_lock);
 }
 
 void main_imu_wakeup(void)
 {
-	if (!main_suspended) // don't wake up if pending suspension
-		k_wakeup(&sensor_thread_id);
+	struct sensor_thread_msg msg = {SENSOR_THREAD_CMD_WAKEUP, 0}; // not acknowledged, may be sent without the lock
+	if (sensor_thread_state == SENSOR_THREAD_RUNNING) // don't wake up if suspended
+		k_msgq_put(&sensor_thread_msgq, &msg, K_NO_WAIT);
 }
 
 void main_imu_restart(void)
 {
-	if (main_ok) // only restart fusion if initialized
-		sensor_fusion->init(gyro_actual_time, accel_actual_time, 6 / 1000.0f); // TODO: using default initial time
+	if (k_current_get() == &sensor_thread_id)
+	{
+		sensor_fusion_restart();
+		return;
+	}
+	k_mutex_lock(&sensor_thread_lock, K_FOREVER);
+	if (sensor_thread_state == SENSOR_THREAD_RUNNING || sensor_thread_state == SENSOR_THREAD_SUSPENDED)
+		sensor_thread_request(SENSOR_THREAD_CMD_RESTART); // reinitialize between iterations
+	else
+		sensor_fusion_restart();
+	k_mutex_unlock(&sensor_thread_lock);
 }
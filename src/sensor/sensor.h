@@ -23,6 +23,8 @@
 #ifndef SLIMENRF_SENSOR
 #define SLIMENRF_SENSOR
 
+#include "retained.h"
+
 #include "interface.h"
 
 const char* sensor_get_sensor_imu_name(void);
@@ -51,16 +53,17 @@ void main_imu_restart(void);
 
 typedef struct sensor_fusion {
 	void (*init)(float, float, float);  // gyro_time, accel_time, mag_time
-	void (*load)(const void*);
-	void (*save)(void*);
+	void (*update_rate)(float, float, float);  // gyro_time, accel_time, mag_time, keeps the fusion state
+	void (*load)(const struct retained_fusion_state*);  // applied after init, restores the convergent state
+	void (*save)(struct retained_fusion_state*);
 
 	void (*update_gyro)(float*, float);  // deg/s
 	void (*update_accel)(float*, float);  // g
 	void (*update_mag)(float*, float);  // any unit (usually gauss)
 	void (*update)(float*, float*, float*, float);
 
-	void (*get_gyro_bias)(float*);
-	void (*set_gyro_bias)(float*);
+	void (*get_gyro_bias)(float*);  // deg/s
+	void (*set_gyro_bias)(float*);  // deg/s
 
 	void (*update_gyro_sanity)(float*, float*);
 	int (*get_gyro_sanity)(void);
@@ -74,6 +77,7 @@ typedef struct sensor_imu {
 	void (*shutdown)(void);
 
 	void (*update_fs)(float, float, float*, float*); // return actual range
+	int (*set_fs)(float, float, float*, float*); // change range while running, return actual range, return 0 if success, 1 if range is same, -1 if general error or not supported
 	int (*update_odr)(float, float, float*, float*); // return actual update time, return 0 if success, 1 if odr is same, -1 if general error
 
 	uint16_t (*fifo_read)(uint8_t*, uint16_t);
@@ -86,6 +90,8 @@ typedef struct sensor_imu {
 
 	int (*ext_setup)(void); // register write/writeread with interface, return 0 if success, -1 if error or not available
 	int (*ext_passthrough)(bool); // enable/disable passthrough mode, return 0 if success, -1 if error or not available
+	int (*ext_fifo_setup)(uint8_t, uint8_t, uint8_t, float, float*); // addr, reg, len, time: read external sensor continuously into FIFO, len of 0 disables, return actual read time, return 0 if success, -1 if error or not available
+	int (*fifo_process_ext)(uint16_t, uint8_t*, uint8_t*); // return external sensor data, return 0 if success, 1 if packet is not external sensor data
 } sensor_imu_t;
 
 typedef struct sensor_mag {
@@ -101,6 +107,7 @@ typedef struct sensor_mag {
 	void (*mag_process)(uint8_t*, float[3]); // use if magnetometer is present as an auxiliary sensor, from data read by IMU
 	uint8_t ext_min_burst; // minimum supported burst length for external interface
 	uint8_t ext_burst; // default supported burst length
+	uint8_t ext_data_reg; // first data register read by mag_read, used if the IMU reads the magnetometer by itself
 } sensor_mag_t;
 
 #endif
\ No newline at end of file
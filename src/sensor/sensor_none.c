@@ -44,6 +44,12 @@ void imu_none_update_fs(float accel_range, float gyro_range, float *accel_actual
 	return;
 }
 
+int imu_none_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range)
+{
+	LOG_DBG("imu_none_set_fs, sensor has no IMU or IMU has no configurable FS");
+	return -1;
+}
+
 int imu_none_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time)
 {
 	LOG_DBG("imu_none_update_odr, sensor has no IMU or IMU has no configurable ODR");
@@ -98,11 +104,24 @@ int imu_none_ext_passthrough(bool passthrough)
 	return -1;
 }
 
+int imu_none_ext_fifo_setup(uint8_t addr, uint8_t reg, uint8_t len, float time, float *actual_time)
+{
+	LOG_DBG("imu_none_ext_fifo_setup, sensor has no IMU or IMU has no ext FIFO support");
+	return -1;
+}
+
+int imu_none_fifo_process_ext(uint16_t index, uint8_t *data, uint8_t *raw_ext)
+{
+	LOG_DBG("imu_none_fifo_process_ext, sensor has no IMU or IMU has no ext FIFO support");
+	return 1;
+}
+
 const sensor_imu_t sensor_imu_none = {
 	*imu_none_init,
 	*imu_none_shutdown,
 
 	*imu_none_update_fs,
+	*imu_none_set_fs,
 	*imu_none_update_odr,
 
 	*imu_none_fifo_read,
@@ -114,7 +133,10 @@ const sensor_imu_t sensor_imu_none = {
 	*imu_none_setup_WOM,
 	
 	*imu_none_ext_setup,
-	*imu_none_ext_passthrough
+	*imu_none_ext_passthrough,
+
+	*imu_none_ext_fifo_setup,
+	*imu_none_fifo_process_ext
 };
 
 int mag_none_init(float time, float *actual_time)
@@ -170,5 +192,5 @@ const sensor_mag_t sensor_mag_none = {
 	*mag_none_temp_read,
 
 	*mag_none_mag_process,
-	UINT8_MAX, UINT8_MAX
+	UINT8_MAX, UINT8_MAX, 0
 };
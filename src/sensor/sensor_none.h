@@ -28,6 +28,7 @@
 int imu_none_init(float clock_rate, float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time);
 void imu_none_shutdown(void);
 
+int imu_none_set_fs(float accel_range, float gyro_range, float *accel_actual_range, float *gyro_actual_range);
 int imu_none_update_odr(float accel_time, float gyro_time, float *accel_actual_time, float *gyro_actual_time);
 
 uint16_t imu_none_fifo_read(uint8_t *data, uint16_t len);
@@ -41,6 +42,9 @@ uint8_t imu_none_setup_WOM(void);
 int imu_none_ext_setup(void);
 int imu_none_ext_passthrough(bool passthrough);
 
+int imu_none_ext_fifo_setup(uint8_t addr, uint8_t reg, uint8_t len, float time, float *actual_time);
+int imu_none_fifo_process_ext(uint16_t index, uint8_t *data, uint8_t *raw_ext);
+
 extern const sensor_imu_t sensor_imu_none;
 
 int mag_none_init(float time, float *actual_time);
@@ -278,7 +278,7 @@ void sys_update_battery_tracker(int16_t pptt, bool plugged)
 		}
 	}
 
-	retained_update();
+	retained_update_section(RETAINED_SECTION_BATTERY);
 }
 
 static int16_t last_pptt = -1;
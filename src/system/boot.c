@@ -0,0 +1,84 @@
+#include "globals.h"
+
+#include <zephyr/kernel.h>
+
+#include "boot.h"
+#include "work.h"
+
+static bool boot_fast_resume = false;
+static bool boot_retained_ready = false;
+
+LOG_MODULE_REGISTER(boot, LOG_LEVEL_INF);
+
+static void boot_update_work_handler(struct k_work *work)
+{
+	retained_update_section(RETAINED_SECTION_SYSTEM);
+}
+
+static K_WORK_DEFINE(boot_update_work, boot_update_work_handler);
+
+static const char *const boot_phase_names[SYS_BOOT_PHASE_COUNT] = {
+	"Retained",
+	"Main",
+	"Scan",
+	"Sensor",
+	"Radio",
+	"Orientation",
+	"Packet",
+};
+
+BUILD_ASSERT(SYS_BOOT_PHASE_COUNT <= ARRAY_SIZE(((struct retained_data *)0)->boot_phase_us[0]), "Boot phases exceed retained boot profile");
+
+void sys_boot_init(bool reset_pin_reset)
+{
+	// The system section is reset if it was not valid, so boot_resume is only set if it was kept from system off
+	boot_fast_resume = retained->boot_resume && !reset_pin_reset && retained_section_valid(RETAINED_SECTION_SCAN);
+	retained->boot_resume = 0;
+	memset(retained->boot_phase_us[boot_fast_resume], 0, sizeof(retained->boot_phase_us[0]));
+	boot_retained_ready = true;
+	sys_boot_mark(SYS_BOOT_PHASE_RETAINED);
+	if (boot_fast_resume)
+		LOG_INF("Fast resume from system off");
+}
+
+void sys_boot_mark(enum sys_boot_phase phase)
+{
+	if (!boot_retained_ready)
+		return;
+	uint32_t *profile = retained->boot_phase_us[boot_fast_resume];
+	if (profile[phase])
+		return; // only the first time each phase is reached
+	profile[phase] = MAX(k_ticks_to_us_floor32(k_uptime_ticks()), 1); // zero is not reached
+	if (k_is_in_isr())
+		k_work_submit_to_queue(&sys_work_q, &boot_update_work); // only the timestamp is written from ISR, the checksum is updated later
+	else
+		retained_update_section(RETAINED_SECTION_SYSTEM);
+}
+
+bool sys_boot_fast_resume(void)
+{
+	return boot_fast_resume;
+}
+
+// Call right before system off with IMU wake up, the scan and radio state are kept for the next boot
+void sys_boot_request_resume(void)
+{
+	retained->boot_resume = 1;
+	retained_update_section(RETAINED_SECTION_SYSTEM);
+}
+
+void sys_boot_print(void)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		printk("\n%s%s:\n", i ? "Fast resume" : "Full boot", i == boot_fast_resume ? " (current)" : "");
+		const uint32_t *profile = retained->boot_phase_us[i];
+		for (int j = 0; j < SYS_BOOT_PHASE_COUNT; j++)
+		{
+			if (profile[j])
+				printk("%-12s %u.%03ums\n", boot_phase_names[j], profile[j] / 1000, profile[j] % 1000);
+			else
+				printk("%-12s Not reached\n", boot_phase_names[j]);
+		}
+	}
+}
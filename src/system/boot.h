@@ -0,0 +1,26 @@
+#ifndef SLIMENRF_SYSTEM_BOOT
+#define SLIMENRF_SYSTEM_BOOT
+
+#include <stdbool.h>
+
+enum sys_boot_phase {
+	SYS_BOOT_PHASE_RETAINED, // retained data validated
+	SYS_BOOT_PHASE_MAIN, // main started
+	SYS_BOOT_PHASE_SCAN, // sensor scan finished
+	SYS_BOOT_PHASE_SENSOR, // sensors and fusion initialized
+	SYS_BOOT_PHASE_RADIO, // ESB initialized
+	SYS_BOOT_PHASE_ORIENTATION, // first orientation from fusion
+	SYS_BOOT_PHASE_PACKET, // first packet acknowledged by the receiver
+	SYS_BOOT_PHASE_COUNT
+};
+
+void sys_boot_init(bool reset_pin_reset);
+
+void sys_boot_mark(enum sys_boot_phase phase);
+
+bool sys_boot_fast_resume(void);
+void sys_boot_request_resume(void);
+
+void sys_boot_print(void);
+
+#endif
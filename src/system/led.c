@@ -8,12 +8,11 @@
 #include <zephyr/pm/device.h>
 
 #include "led.h"
+#include "sleep.h"
+#include "work.h"
 
 LOG_MODULE_REGISTER(led, LOG_LEVEL_INF);
 
-static void led_thread(void);
-K_THREAD_DEFINE(led_thread_id, 512, led_thread, NULL, NULL, NULL, 6, 0, 0);
-
 #define ZEPHYR_USER_NODE DT_PATH(zephyr_user)
 
 #if DT_NODE_HAS_PROP(ZEPHYR_USER_NODE, led_gpios)
@@ -66,7 +65,11 @@ static int current_priority;
 
 #if LED_EXISTS
 static enum sys_led_pattern led_patterns[SYS_LED_PATTERN_DEPTH] = {[0 ... (SYS_LED_PATTERN_DEPTH - 1)] = SYS_LED_PATTERN_OFF};
-static int led_pattern_state;
+
+static K_MUTEX_DEFINE(led_lock);
+
+static void led_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(led_work, led_work_handler);
 
 static int led_pin_init(void)
 {
@@ -224,17 +227,69 @@ static void led_pin_set(enum sys_led_color color, int brightness_pptt, int value
 	gpio_pin_set_dt(&led, value_pptt > 5000);
 #endif
 }
-#endif
 
-void set_led(enum sys_led_pattern led_pattern, int priority)
+#define LED_FADE_STEP_MS 20 // PWM holds the level between updates
+
+struct led_step {
+	int16_t value_pptt;
+	int16_t time_ms; // 0 holds the step until the pattern changes
+	bool fade; // ramp from the previous step value over time_ms
+	bool dim; // ramp the brightness from the pattern brightness instead, the value stays on (GPIO only LEDs stay on until the end)
+};
+
+struct led_pattern {
+	enum sys_led_color color;
+	int brightness_pptt;
+	const struct led_step *steps;
+	int count;
+	enum sys_led_pattern end; // set after the last step, SYS_LED_PATTERN_DEPTH repeats the pattern
+};
+
+#define LED_REPEAT SYS_LED_PATTERN_DEPTH
+
+static const struct led_step led_steps_on[] = {{10000, 0}};
+static const struct led_step led_steps_short[] = {{10000, 100}, {0, 900}};
+static const struct led_step led_steps_long[] = {{10000, 500}, {0, 500}};
+static const struct led_step led_steps_flash[] = {{10000, 200}, {0, 200}};
+static const struct led_step led_steps_poweron[] = {{0, 200}, {10000, 200}, {0, 200}, {10000, 200}, {0, 200}, {10000, 200}};
+static const struct led_step led_steps_poweroff[] = {{0, 250}, {0, 1000, true, true}};
+static const struct led_step led_steps_progress[] = {{0, 200}, {10000, 200}, {0, 200}, {10000, 200}};
+static const struct led_step led_steps_complete[] = {{0, 200}, {10000, 200}, {0, 200}, {10000, 200}, {0, 200}, {10000, 200}, {0, 200}, {10000, 200}};
+static const struct led_step led_steps_pulse[] = {{6000, 1000, true}, {8000, 500, true}, {9500, 500, true}, {10000, 500, true}, {9500, 500, true}, {8000, 500, true}, {6000, 500, true}, {0, 1000, true}};
+static const struct led_step led_steps_active[] = {{0, 9700}, {10000, 300}}; // off duration first because the device may turn on multiple times rapidly and waste battery power
+static const struct led_step led_steps_error_a[] = {{10000, 500}, {0, 500}, {10000, 500}, {0, 3500}};
+static const struct led_step led_steps_error_b[] = {{10000, 500}, {0, 500}, {10000, 500}, {0, 500}, {10000, 500}, {0, 2500}};
+static const struct led_step led_steps_error_c[] = {{10000, 500}, {0, 500}, {10000, 500}, {0, 500}, {10000, 500}, {0, 500}, {10000, 500}, {0, 1500}};
+
+static const struct led_pattern led_pattern_table[] = {
+	[SYS_LED_PATTERN_ON] = {SYS_LED_COLOR_DEFAULT, 10000, led_steps_on, ARRAY_SIZE(led_steps_on), LED_REPEAT},
+	[SYS_LED_PATTERN_SHORT] = {SYS_LED_COLOR_DEFAULT, 10000, led_steps_short, ARRAY_SIZE(led_steps_short), LED_REPEAT},
+	[SYS_LED_PATTERN_LONG] = {SYS_LED_COLOR_DEFAULT, 10000, led_steps_long, ARRAY_SIZE(led_steps_long), LED_REPEAT},
+	[SYS_LED_PATTERN_FLASH] = {SYS_LED_COLOR_DEFAULT, 10000, led_steps_flash, ARRAY_SIZE(led_steps_flash), LED_REPEAT},
+
+	[SYS_LED_PATTERN_ONESHOT_POWERON] = {SYS_LED_COLOR_DEFAULT, 10000, led_steps_poweron, ARRAY_SIZE(led_steps_poweron), SYS_LED_PATTERN_OFF},
+	[SYS_LED_PATTERN_ONESHOT_POWEROFF] = {SYS_LED_COLOR_DEFAULT, 10000, led_steps_poweroff, ARRAY_SIZE(led_steps_poweroff), SYS_LED_PATTERN_OFF_FORCE},
+	[SYS_LED_PATTERN_ONESHOT_PROGRESS] = {SYS_LED_COLOR_SUCCESS, 10000, led_steps_progress, ARRAY_SIZE(led_steps_progress), SYS_LED_PATTERN_OFF},
+	[SYS_LED_PATTERN_ONESHOT_COMPLETE] = {SYS_LED_COLOR_SUCCESS, 10000, led_steps_complete, ARRAY_SIZE(led_steps_complete), SYS_LED_PATTERN_OFF},
+
+	[SYS_LED_PATTERN_ON_PERSIST] = {SYS_LED_COLOR_SUCCESS, 2000, led_steps_on, ARRAY_SIZE(led_steps_on), LED_REPEAT},
+	[SYS_LED_PATTERN_LONG_PERSIST] = {SYS_LED_COLOR_CHARGING, 2000, led_steps_long, ARRAY_SIZE(led_steps_long), LED_REPEAT},
+	[SYS_LED_PATTERN_PULSE_PERSIST] = {SYS_LED_COLOR_CHARGING, 10000, led_steps_pulse, ARRAY_SIZE(led_steps_pulse), LED_REPEAT},
+	[SYS_LED_PATTERN_ACTIVE_PERSIST] = {SYS_LED_COLOR_DEFAULT, 10000, led_steps_active, ARRAY_SIZE(led_steps_active), LED_REPEAT},
+
+	[SYS_LED_PATTERN_ERROR_A] = {SYS_LED_COLOR_ERROR, 10000, led_steps_error_a, ARRAY_SIZE(led_steps_error_a), LED_REPEAT}, // TODO: should this use 20% duty cycle?
+	[SYS_LED_PATTERN_ERROR_B] = {SYS_LED_COLOR_ERROR, 10000, led_steps_error_b, ARRAY_SIZE(led_steps_error_b), LED_REPEAT},
+	[SYS_LED_PATTERN_ERROR_C] = {SYS_LED_COLOR_ERROR, 10000, led_steps_error_c, ARRAY_SIZE(led_steps_error_c), LED_REPEAT},
+	[SYS_LED_PATTERN_ERROR_D] = {SYS_LED_COLOR_ERROR, 10000, led_steps_long, ARRAY_SIZE(led_steps_long), LED_REPEAT},
+};
+
+static int led_step_index;
+static int64_t led_step_time; // start of the current step
+static int led_step_value; // value at the start of the current step
+
+static void led_update(enum sys_led_pattern led_pattern, int priority)
 {
-	LOG_DBG("set_led: current_led_pattern %d, current_priority %d", current_led_pattern, current_priority);
-	LOG_DBG("set_led: pattern %d, priority %d", led_pattern, priority);
-#if LED_EXISTS
-	if (led_pattern <= SYS_LED_PATTERN_OFF && k_current_get() == led_thread_id)
-		led_patterns[current_priority] = led_pattern;
-	else
-		led_patterns[priority] = led_pattern;
+	led_patterns[priority] = led_pattern;
 	for (priority = 0; priority < SYS_LED_PATTERN_DEPTH; priority++)
 	{
 		if (led_patterns[priority] == SYS_LED_PATTERN_OFF)
@@ -244,158 +299,77 @@ void set_led(enum sys_led_pattern led_pattern, int priority)
 	}
 	if (led_pattern == current_led_pattern && led_pattern > SYS_LED_PATTERN_OFF)
 		return;
+	bool led_active = current_led_pattern > SYS_LED_PATTERN_OFF;
 	current_led_pattern = led_pattern;
 	current_priority = priority;
-	led_pattern_state = 0;
-	if (current_led_pattern <= SYS_LED_PATTERN_OFF)
+	if (current_led_pattern <= SYS_LED_PATTERN_OFF || current_led_pattern >= ARRAY_SIZE(led_pattern_table))
 	{
+		k_work_cancel_delayable(&led_work);
 		led_suspend();
-		k_thread_suspend(led_thread_id);
-		LOG_DBG("set_led: suspended led_thread_id");
-	}
-	else if (k_current_get() != led_thread_id) // do not suspend if called from thread
-	{
-		k_thread_suspend(led_thread_id);
-		LOG_DBG("set_led: suspended led_thread_id");
-		led_resume();
-		k_thread_resume(led_thread_id);
-		k_wakeup(led_thread_id);
-		LOG_DBG("set_led: resumed led_thread_id");
+		LOG_DBG("set_led: stopped pattern");
+		return;
 	}
-	else
-	{
+	if (!led_active)
 		led_resume();
-		k_thread_resume(led_thread_id);
-		k_wakeup(led_thread_id);
-		LOG_DBG("set_led: resumed led_thread_id");
-	}
-#endif
+	led_step_index = 0;
+	led_step_time = k_uptime_get();
+	led_step_value = 0;
+	k_work_reschedule_for_queue(&sys_work_q, &led_work, K_NO_WAIT);
+	LOG_DBG("set_led: started pattern");
 }
 
-static void led_thread(void)
+// Only wakes at step edges, or every LED_FADE_STEP_MS during a fade
+static void led_work_handler(struct k_work *work)
 {
-#if !LED_EXISTS
-	LOG_WRN("LED GPIO does not exist");
-	return;
-#else
-	while (1)
+	k_mutex_lock(&led_lock, K_FOREVER);
+	if (current_led_pattern <= SYS_LED_PATTERN_OFF || current_led_pattern >= ARRAY_SIZE(led_pattern_table))
+	{
+		k_mutex_unlock(&led_lock);
+		return; // stopped while waiting
+	}
+	const struct led_pattern *pattern = &led_pattern_table[current_led_pattern];
+	int64_t time = k_uptime_get();
+	while (pattern->steps[led_step_index].time_ms && time - led_step_time >= pattern->steps[led_step_index].time_ms) // step done
 	{
-		LOG_DBG("led_thread: current_led_pattern %d", current_led_pattern);
-		switch (current_led_pattern)
+		led_step_value = pattern->steps[led_step_index].value_pptt;
+		led_step_time += pattern->steps[led_step_index].time_ms;
+		if (++led_step_index < pattern->count)
+			continue;
+		if (pattern->end != LED_REPEAT)
 		{
-		case SYS_LED_PATTERN_ON:
-			led_pin_set(SYS_LED_COLOR_DEFAULT, 10000, 10000);
-			k_thread_suspend(led_thread_id);
-			break;
-		case SYS_LED_PATTERN_SHORT:
-			led_pattern_state = (led_pattern_state + 1) % 2;
-			led_pin_set(SYS_LED_COLOR_DEFAULT, 10000, led_pattern_state * 10000);
-			k_msleep(led_pattern_state == 1 ? 100 : 900);
-			break;
-		case SYS_LED_PATTERN_LONG:
-			led_pattern_state = (led_pattern_state + 1) % 2;
-			led_pin_set(SYS_LED_COLOR_DEFAULT, 10000, led_pattern_state * 10000);
-			k_msleep(500);
-			break;
-		case SYS_LED_PATTERN_FLASH:
-			led_pattern_state = (led_pattern_state + 1) % 2;
-			led_pin_set(SYS_LED_COLOR_DEFAULT, 10000, led_pattern_state * 10000);
-			k_msleep(200);
-			break;
-
-		case SYS_LED_PATTERN_ONESHOT_POWERON:
-			led_pattern_state++;
-			led_pin_set(SYS_LED_COLOR_DEFAULT, 10000, !(led_pattern_state % 2) * 10000);
-			if (led_pattern_state == 7)
-				set_led(SYS_LED_PATTERN_OFF, SYS_LED_PRIORITY_HIGHEST);
-			else
-				k_msleep(200);
-			break;
-		case SYS_LED_PATTERN_ONESHOT_POWEROFF:
-			if (led_pattern_state++ > 0)
-				led_pin_set(SYS_LED_COLOR_DEFAULT, (202 - led_pattern_state) * 50, (led_pattern_state != 202 ? 10000 : 0));
-			else
-				led_pin_set(SYS_LED_COLOR_DEFAULT, 10000, 0);
-			if (led_pattern_state == 202)
-				set_led(SYS_LED_PATTERN_OFF_FORCE, SYS_LED_PRIORITY_HIGHEST);
-			else if (led_pattern_state == 1)
-				k_msleep(250);
-			else
-				k_msleep(5);
-			break;
-		case SYS_LED_PATTERN_ONESHOT_PROGRESS:
-			led_pattern_state++;
-			led_pin_set(SYS_LED_COLOR_SUCCESS, 10000, !(led_pattern_state % 2) * 10000);
-			if (led_pattern_state == 5)
-				set_led(SYS_LED_PATTERN_OFF, SYS_LED_PRIORITY_HIGHEST);
-			else
-				k_msleep(200);
-			break;
-		case SYS_LED_PATTERN_ONESHOT_COMPLETE:
-			led_pattern_state++;
-			led_pin_set(SYS_LED_COLOR_SUCCESS, 10000, !(led_pattern_state % 2) * 10000);
-			if (led_pattern_state == 9)
-				set_led(SYS_LED_PATTERN_OFF, SYS_LED_PRIORITY_HIGHEST);
-			else
-				k_msleep(200);
-			break;
-
-		case SYS_LED_PATTERN_ON_PERSIST:
-			led_pin_set(SYS_LED_COLOR_SUCCESS, 2000, 10000);
-			k_thread_suspend(led_thread_id);
-			break;
-		case SYS_LED_PATTERN_LONG_PERSIST:
-			led_pattern_state = (led_pattern_state + 1) % 2;
-			led_pin_set(SYS_LED_COLOR_CHARGING, 2000, led_pattern_state * 10000);
-			k_msleep(500);
-			break;
-		case SYS_LED_PATTERN_PULSE_PERSIST:
-			led_pattern_state = (led_pattern_state + 1) % 1000;
-//			float led_value = sinf(led_pattern_state * (M_PI / 1000));
-//			led_pin_set(SYS_LED_COLOR_CHARGING, 10000, led_value * 10000);
-			int led_value = led_pattern_state > 500 ? 1000 - led_pattern_state : led_pattern_state;
-			if (led_value < 200)
-				led_value = (led_value) * 30;
-			else if (led_value < 300)
-				led_value = (led_value - 200) * 20 + 6000;
-			else if (led_value < 400)
-				led_value = (led_value - 300) * 15 + 8000;
-			else
-				led_value = (led_value - 400) * 5 + 9500;
-			led_pin_set(SYS_LED_COLOR_CHARGING, 10000, led_value);
-			k_msleep(5);
-			break;
-		case SYS_LED_PATTERN_ACTIVE_PERSIST: // off duration first because the device may turn on multiple times rapidly and waste battery power
-			led_pattern_state = (led_pattern_state + 1) % 2;
-			led_pin_set(SYS_LED_COLOR_DEFAULT, 10000, !led_pattern_state * 10000);
-			k_msleep(led_pattern_state ? 9700 : 300);
-			break;
-
-		case SYS_LED_PATTERN_ERROR_A: // TODO: should this use 20% duty cycle?
-			led_pattern_state = (led_pattern_state + 1) % 10;
-			led_pin_set(SYS_LED_COLOR_ERROR, 10000, (led_pattern_state < 4 && led_pattern_state % 2) * 10000);
-			k_msleep(500);
-			break;
-		case SYS_LED_PATTERN_ERROR_B:
-			led_pattern_state = (led_pattern_state + 1) % 10;
-			led_pin_set(SYS_LED_COLOR_ERROR, 10000, (led_pattern_state < 6 && led_pattern_state % 2) * 10000);
-			k_msleep(500);
-			break;
-		case SYS_LED_PATTERN_ERROR_C:
-			led_pattern_state = (led_pattern_state + 1) % 10;
-			led_pin_set(SYS_LED_COLOR_ERROR, 10000, (led_pattern_state < 8 && led_pattern_state % 2) * 10000);
-			k_msleep(500);
-			break;
-		case SYS_LED_PATTERN_ERROR_D:
-			led_pattern_state = (led_pattern_state + 1) % 2;
-			led_pin_set(SYS_LED_COLOR_ERROR, 10000, led_pattern_state * 10000);
-			k_msleep(500);
-			break;
-
-		default:
-			LOG_DBG("led_thread: suspending led_thread_id");
-			k_thread_suspend(led_thread_id);
+			led_update(pattern->end, current_priority); // oneshot complete
+			k_mutex_unlock(&led_lock);
+			return;
 		}
+		led_step_index = 0;
+	}
+	const struct led_step *step = &pattern->steps[led_step_index];
+	int elapsed = time - led_step_time;
+	if (step->fade)
+	{
+		if (step->dim)
+			led_pin_set(pattern->color, pattern->brightness_pptt + (step->value_pptt - pattern->brightness_pptt) * elapsed / step->time_ms, 10000);
+		else
+			led_pin_set(pattern->color, pattern->brightness_pptt, led_step_value + (step->value_pptt - led_step_value) * elapsed / step->time_ms);
+		k_work_schedule_for_queue(&sys_work_q, &led_work, sys_sleep_timeout(MIN(LED_FADE_STEP_MS, step->time_ms - elapsed))); // steps use the elapsed time, a late wake up does not shift the pattern
 	}
+	else
+	{
+		led_pin_set(pattern->color, pattern->brightness_pptt, step->value_pptt);
+		if (step->time_ms)
+			k_work_schedule_for_queue(&sys_work_q, &led_work, sys_sleep_timeout(step->time_ms - elapsed));
+	}
+	k_mutex_unlock(&led_lock);
+}
+#endif
+
+void set_led(enum sys_led_pattern led_pattern, int priority)
+{
+	LOG_DBG("set_led: current_led_pattern %d, current_priority %d", current_led_pattern, current_priority);
+	LOG_DBG("set_led: pattern %d, priority %d", led_pattern, priority);
+#if LED_EXISTS
+	k_mutex_lock(&led_lock, K_FOREVER);
+	led_update(led_pattern, priority);
+	k_mutex_unlock(&led_lock);
 #endif
 }
@@ -0,0 +1,100 @@
+#include "globals.h"
+#include "connection/connection.h"
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/sys_heap.h>
+
+#include "mem.h"
+#include "sleep.h"
+#include "work.h"
+
+LOG_MODULE_REGISTER(mem, LOG_LEVEL_INF);
+
+#if CONFIG_SYS_MEM_STATS
+#define MEM_STATS_INTERVAL_MS 10000
+#define MEM_STACK_WARN_PERCENT 10 // warn if a thread has less free stack than this
+
+#if CONFIG_HEAP_MEM_POOL_SIZE > 0
+extern struct k_heap _system_heap; // k_malloc heap
+#endif
+
+static uint8_t mem_stack_warned = MEM_STACK_WARN_PERCENT; // only warn again for a new low
+
+static void mem_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(mem_work, mem_work_handler);
+
+static void mem_stack_check(const struct k_thread *thread, void *user_data)
+{
+	uint8_t *min_free_percent = user_data;
+	size_t size = thread->stack_info.size;
+	size_t unused;
+	if (size == 0 || k_thread_stack_space_get(thread, &unused))
+		return;
+	uint8_t free_percent = unused * 100 / size;
+	const char *name = k_thread_name_get((k_tid_t)thread);
+	if (free_percent < *min_free_percent)
+		*min_free_percent = free_percent;
+	if (free_percent < mem_stack_warned)
+	{
+		LOG_WRN("Stack of %s is low: %zu of %zu bytes free", name ? name : "thread", unused, size);
+		mem_stack_warned = free_percent;
+	}
+}
+
+static void mem_work_handler(struct k_work *work)
+{
+	uint8_t min_free_percent = 100;
+	k_thread_foreach_unlocked(mem_stack_check, &min_free_percent); // stacks are scanned for the fill pattern, do not hold the lock
+#if CONFIG_CONNECTION_USE_MEM_STATS
+	struct sys_memory_stats stats = {0};
+#if CONFIG_HEAP_MEM_POOL_SIZE > 0
+	sys_heap_runtime_stats_get(&_system_heap.heap, &stats);
+#endif
+	connection_update_mem_stats(min_free_percent, stats.max_allocated_bytes, stats.free_bytes);
+#endif
+	k_work_schedule_for_queue(&sys_work_q, &mem_work, sys_sleep_timeout(MEM_STATS_INTERVAL_MS));
+}
+
+static int mem_work_init(void)
+{
+	k_work_schedule_for_queue(&sys_work_q, &mem_work, K_MSEC(MEM_STATS_INTERVAL_MS));
+	return 0;
+}
+
+SYS_INIT(mem_work_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+static void mem_print_thread(const struct k_thread *thread, void *user_data)
+{
+	size_t size = thread->stack_info.size;
+	size_t unused;
+	const char *name = k_thread_name_get((k_tid_t)thread);
+	if (size == 0 || k_thread_stack_space_get(thread, &unused))
+	{
+		printk("%-20s %5zu     Not available\n", name ? name : "", size);
+		return;
+	}
+	printk("%-20s %5zu %5zu %5zu (%zu%%)\n", name ? name : "", size, size - unused, unused, unused * 100 / size);
+}
+
+void sys_mem_print(void)
+{
+	printk("Thread                Size  Used  Free\n");
+	k_thread_foreach_unlocked(mem_print_thread, NULL);
+#if CONFIG_HEAP_MEM_POOL_SIZE > 0
+	struct sys_memory_stats stats;
+	sys_heap_runtime_stats_get(&_system_heap.heap, &stats);
+	printk("\nHeap: %zu bytes\n", stats.free_bytes + stats.allocated_bytes); // usable size, without the allocator overhead
+	printk("Allocated: %zu bytes\n", stats.allocated_bytes);
+	printk("Free: %zu bytes\n", stats.free_bytes);
+	printk("Peak allocated: %zu bytes\n", stats.max_allocated_bytes);
+#else
+	printk("\nHeap: None\n");
+#endif
+}
+#else
+void sys_mem_print(void)
+{
+	printk("Memory statistics not enabled\n");
+}
+#endif
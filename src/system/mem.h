@@ -0,0 +1,6 @@
+#ifndef SLIMENRF_SYSTEM_MEM
+#define SLIMENRF_SYSTEM_MEM
+
+void sys_mem_print(void);
+
+#endif
@@ -6,6 +6,7 @@
 #include "system.h"
 #include "led.h"
 #include "connection/esb.h"
+#include "work.h"
 
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log_ctrl.h>
@@ -43,11 +44,13 @@ static bool device_plugged = false;
 
 LOG_MODULE_REGISTER(power, LOG_LEVEL_INF);
 
-static void disable_DFU_thread(void);
-K_THREAD_DEFINE(disable_DFU_thread_id, 128, disable_DFU_thread, NULL, NULL, NULL, 6, 0, 500); // disable DFU if the system is running correctly
+#define POWER_INTERVAL_MS 100
 
-static void power_thread(void);
-K_THREAD_DEFINE(power_thread_id, 1024, power_thread, NULL, NULL, NULL, 6, 0, 0);
+static void disable_DFU_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(disable_DFU_work, disable_DFU_work_handler); // disable DFU if the system is running correctly
+
+static void power_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(power_work, power_work_handler);
 
 #define ZEPHYR_USER_NODE DT_PATH(zephyr_user)
 
@@ -71,44 +74,127 @@ static const struct gpio_dt_spec ldo_en = GPIO_DT_SPEC_GET(ZEPHYR_USER_NODE, ldo
 
 #define ADAFRUIT_BOOTLOADER CONFIG_BUILD_OUTPUT_UF2
 
+#if !CONFIG_SENSOR_INTERFACE_PM_NONE
+#define INTERFACE_PM_DEV(node) COND_CODE_1(DT_NODE_HAS_STATUS_OKAY(node), (DEVICE_DT_GET(DT_PARENT(node)),), ())
+
+// Sensor buses, a bus shared by multiple sensors is listed more than once
+static const struct device *const interface_devs[] = {
+	INTERFACE_PM_DEV(DT_NODELABEL(imu_spi))
+	INTERFACE_PM_DEV(DT_NODELABEL(imu))
+	INTERFACE_PM_DEV(DT_NODELABEL(mag_spi))
+	INTERFACE_PM_DEV(DT_NODELABEL(mag))
+	INTERFACE_PM_DEV(DT_NODELABEL(imu1_spi))
+	INTERFACE_PM_DEV(DT_NODELABEL(imu1))
+	INTERFACE_PM_DEV(DT_NODELABEL(imu2_spi))
+	INTERFACE_PM_DEV(DT_NODELABEL(imu2))
+};
+
+#define INTERFACE_PM_LOG_INTERVAL_MS 60000
+
+static K_MUTEX_DEFINE(interface_lock);
+static int interface_refs;
+static bool interface_suspended;
+
+// Resume latency and suspended time, to compare suspend policies on a board
+static uint32_t interface_resume_count;
+static uint32_t interface_resume_total_us;
+static uint32_t interface_resume_max_us;
+static int64_t interface_suspend_time;
+static int64_t interface_suspended_total;
+static int64_t interface_log_time;
+
+static void interface_action(enum pm_device_action action)
+{
+	for (int i = 0; i < ARRAY_SIZE(interface_devs); i++)
+	{
+		bool done = false;
+		for (int j = 0; j < i; j++)
+			done |= interface_devs[j] == interface_devs[i];
+		if (done)
+			continue; // shared bus
+		int err = pm_device_action_run(interface_devs[i], action);
+		if (err && err != -EALREADY)
+			LOG_ERR("Failed to %s %s: %d", action == PM_DEVICE_ACTION_SUSPEND ? "suspend" : "resume", interface_devs[i]->name, err);
+	}
+}
+
+static void interface_suspend_now(void)
+{
+	interface_action(PM_DEVICE_ACTION_SUSPEND);
+	interface_suspended = true;
+	interface_suspend_time = k_uptime_get();
+}
+
+#if CONFIG_SENSOR_INTERFACE_PM_DEFERRED
+static void interface_suspend_work_handler(struct k_work *work)
+{
+	k_mutex_lock(&interface_lock, K_FOREVER);
+	if (interface_refs == 0 && !interface_suspended)
+		interface_suspend_now();
+	k_mutex_unlock(&interface_lock);
+}
+
+static K_WORK_DELAYABLE_DEFINE(interface_suspend_work, interface_suspend_work_handler);
+#endif
+
+static void interface_log(void)
+{
+	int64_t time = k_uptime_get();
+	if (interface_log_time == 0)
+		interface_log_time = time;
+	if (time - interface_log_time < INTERFACE_PM_LOG_INTERVAL_MS || interface_resume_count == 0)
+		return;
+	LOG_INF("Sensor bus: %u resumes, resume %uus average, %uus max, suspended %lld%%", interface_resume_count, interface_resume_total_us / interface_resume_count, interface_resume_max_us, interface_suspended_total * 100 / (time - interface_log_time));
+	interface_resume_count = 0;
+	interface_resume_total_us = 0;
+	interface_resume_max_us = 0;
+	interface_suspended_total = 0;
+	interface_log_time = time;
+}
+#endif
+
+// Reference counted, the buses are suspended after the last user is done
 void sys_interface_suspend(void)
 {
-// #if DT_NODE_HAS_STATUS_OKAY(DT_PARENT(DT_NODELABEL(imu_spi)))
-// 	const struct device *const pm_spi_imu = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(imu_spi)));
-// 	pm_device_action_run(pm_spi_imu, PM_DEVICE_ACTION_SUSPEND);
-// #endif
-// #if DT_NODE_HAS_STATUS_OKAY(DT_PARENT(DT_NODELABEL(imu)))
-// 	const struct device *const pm_i2c_imu = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(imu)));
-// 	pm_device_action_run(pm_i2c_imu, PM_DEVICE_ACTION_SUSPEND);
-// #endif
-// #if DT_NODE_HAS_STATUS_OKAY(DT_PARENT(DT_NODELABEL(mag_spi)))
-// 	const struct device *const pm_spi_mag = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(mag_spi)));
-// 	pm_device_action_run(pm_spi_mag, PM_DEVICE_ACTION_SUSPEND);
-// #endif
-// #if DT_NODE_HAS_STATUS_OKAY(DT_PARENT(DT_NODELABEL(mag)))
-// 	const struct device *const pm_i2c_mag = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(mag)));
-// 	pm_device_action_run(pm_i2c_mag, PM_DEVICE_ACTION_SUSPEND);
-// #endif
+#if !CONFIG_SENSOR_INTERFACE_PM_NONE
+	k_mutex_lock(&interface_lock, K_FOREVER);
+	if (interface_refs > 0 && --interface_refs == 0)
+	{
+#if CONFIG_SENSOR_INTERFACE_PM_DEFERRED
+		k_work_reschedule(&interface_suspend_work, K_USEC(CONFIG_SENSOR_INTERFACE_PM_DELAY));
+#else
+		interface_suspend_now();
+#endif
+	}
+	k_mutex_unlock(&interface_lock);
+#endif
 }
 
 void sys_interface_resume(void)
 {
-// #if DT_NODE_HAS_STATUS_OKAY(DT_PARENT(DT_NODELABEL(imu_spi)))
-// 	const struct device *const pm_spi_imu = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(imu_spi)));
-// 	pm_device_action_run(pm_spi_imu, PM_DEVICE_ACTION_RESUME);
-// #endif
-// #if DT_NODE_HAS_STATUS_OKAY(DT_PARENT(DT_NODELABEL(imu)))
-// 	const struct device *const pm_i2c_imu = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(imu)));
-// 	pm_device_action_run(pm_i2c_imu, PM_DEVICE_ACTION_RESUME);
-// #endif
-// #if DT_NODE_HAS_STATUS_OKAY(DT_PARENT(DT_NODELABEL(mag_spi)))
-// 	const struct device *const pm_spi_mag = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(mag_spi)));
-// 	pm_device_action_run(pm_spi_mag, PM_DEVICE_ACTION_RESUME);
-// #endif
-// #if DT_NODE_HAS_STATUS_OKAY(DT_PARENT(DT_NODELABEL(mag)))
-// 	const struct device *const pm_i2c_mag = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(mag)));
-// 	pm_device_action_run(pm_i2c_mag, PM_DEVICE_ACTION_RESUME);
-// #endif
+#if !CONFIG_SENSOR_INTERFACE_PM_NONE
+	k_mutex_lock(&interface_lock, K_FOREVER);
+	if (interface_refs++ == 0)
+	{
+#if CONFIG_SENSOR_INTERFACE_PM_DEFERRED
+		k_work_cancel_delayable(&interface_suspend_work);
+#endif
+		if (interface_suspended)
+		{
+			uint32_t start = k_cycle_get_32();
+			interface_action(PM_DEVICE_ACTION_RESUME);
+			interface_suspended = false;
+			uint32_t resume_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+			interface_resume_count++;
+			interface_resume_total_us += resume_us;
+			if (resume_us > interface_resume_max_us)
+				interface_resume_max_us = resume_us;
+			interface_suspended_total += k_uptime_get() - interface_suspend_time;
+			interface_log();
+		}
+	}
+	k_mutex_unlock(&interface_lock);
+#endif
 }
 
 // TODO: the gpio sense is weird, maybe the device will turn back on immediately after shutdown or after (attempting to) enter WOM
@@ -213,6 +299,8 @@ void sys_request_WOM(bool force) // TODO: if IMU interrupt does not exist what d
 	LOG_INF("Configured IMU wake up GPIO");
 	LOG_INF("Powering off nRF");
 	sys_update_battery_tracker(current_battery_pptt, device_plugged);
+	sys_flush();
+	sys_boot_request_resume();
 //	retained_update();
 	wait_for_logging();
 #if ADAFRUIT_BOOTLOADER // if using Adafruit bootloader, always skip dfu for next boot
@@ -239,6 +327,7 @@ void sys_request_system_off(void) // TODO: add timeout
 	// Set system off
 	LOG_INF("Powering off nRF");
 	sys_update_battery_tracker(current_battery_pptt, device_plugged);
+	sys_flush();
 //	retained_update();
 	wait_for_logging();
 #if ADAFRUIT_BOOTLOADER // if using Adafruit bootloader, always skip dfu for next boot
@@ -251,10 +340,11 @@ void sys_request_system_reboot(void) // TODO: add timeout
 {
 	LOG_INF("System reboot requested");
 	configure_system_off(); // Common subsystem shutdown and prepare sense pins
-//	sensor_retained_write();
+	sensor_retained_write(); // keep the fusion state
 	// Set system reboot
 	LOG_INF("Rebooting nRF");
 	sys_update_battery_tracker(current_battery_pptt, device_plugged);
+	sys_flush();
 //	retained_update();
 	wait_for_logging();
 #if ADAFRUIT_BOOTLOADER // if using Adafruit bootloader, always skip dfu for next boot
@@ -270,162 +360,171 @@ bool vin_read(void) // blocking
 	return plugged;
 }
 
-static void disable_DFU_thread(void)
+static void disable_DFU_work_handler(struct k_work *work)
 {
 #if ADAFRUIT_BOOTLOADER
 	(*dbl_reset_mem) = DFU_DBL_RESET_APP; // Skip DFU
 #endif
 }
 
-static void power_thread(void)
+static int power_work_init(void)
+{
+	k_work_schedule_for_queue(&sys_work_q, &disable_DFU_work, K_MSEC(500));
+	k_work_schedule_for_queue(&sys_work_q, &power_work, K_NO_WAIT);
+	return 0;
+}
+
+SYS_INIT(power_work_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+static void power_work_handler(struct k_work *work)
 {
-	while (1)
-	{
 #if DT_NODE_HAS_STATUS_OKAY(DT_NODELABEL(uart0))
-		const struct device *const uart = DEVICE_DT_GET(DT_NODELABEL(uart0));
-		pm_device_action_run(uart, PM_DEVICE_ACTION_SUSPEND);
+	const struct device *const uart = DEVICE_DT_GET(DT_NODELABEL(uart0));
+	pm_device_action_run(uart, PM_DEVICE_ACTION_SUSPEND);
 #endif
-		bool docked = dock_read();
-		bool charging = chg_read();
-		bool charged = stby_read();
-
-		int battery_mV;
-		int16_t battery_pptt = read_batt_mV(&battery_mV);
-		if (samples < BATTERY_SAMPLES)
-			samples++;
-
-		bool abnormal_reading = battery_mV < 100 || battery_mV > 6000;
-		bool battery_available = battery_mV > 1500 && !abnormal_reading; // Keep working without the battery connected, otherwise it is obviously too dead to boot system
-		bool battery_discharged = battery_available && (average_pptt >= 0 ? average_pptt : battery_pptt) == 0;
-		// Separate detection of vin
-		if (!plugged && battery_mV > 4300 && !abnormal_reading)
-			plugged = true;
-		else if ((plugged && battery_mV <= 4250) || abnormal_reading)
-			plugged = false;
+	bool docked = dock_read();
+	bool charging = chg_read();
+	bool charged = stby_read();
+
+	int battery_mV;
+	int16_t battery_pptt = read_batt_mV(&battery_mV);
+	if (samples < BATTERY_SAMPLES)
+		samples++;
+
+	bool abnormal_reading = battery_mV < 100 || battery_mV > 6000;
+	bool battery_available = battery_mV > 1500 && !abnormal_reading; // Keep working without the battery connected, otherwise it is obviously too dead to boot system
+	bool battery_discharged = battery_available && (average_pptt >= 0 ? average_pptt : battery_pptt) == 0;
+	// Separate detection of vin
+	if (!plugged && battery_mV > 4300 && !abnormal_reading)
+		plugged = true;
+	else if ((plugged && battery_mV <= 4250) || abnormal_reading)
+		plugged = false;
 #ifdef POWER_USBREGSTATUS_VBUSDETECT_Msk
-		bool usb_plugged = NRF_POWER->USBREGSTATUS & POWER_USBREGSTATUS_VBUSDETECT_Msk;
+	bool usb_plugged = NRF_POWER->USBREGSTATUS & POWER_USBREGSTATUS_VBUSDETECT_Msk;
 #else
-		bool usb_plugged = false;
+	bool usb_plugged = false;
 #endif
 
-		if (!device_plugged && (charging || charged || plugged || usb_plugged))
-		{
-			device_plugged = true;
-			set_status(SYS_STATUS_PLUGGED, true);
-		}
-		else if (device_plugged && !(charging || charged || plugged || usb_plugged))
-		{
-			device_plugged = false;
-			set_status(SYS_STATUS_PLUGGED, false);
-		}
+	if (!device_plugged && (charging || charged || plugged || usb_plugged))
+	{
+		device_plugged = true;
+		set_status(SYS_STATUS_PLUGGED, true);
+	}
+	else if (device_plugged && !(charging || charged || plugged || usb_plugged))
+	{
+		device_plugged = false;
+		set_status(SYS_STATUS_PLUGGED, false);
+	}
 
-		if (!power_init)
+	if (!power_init)
+	{
+		// log battery state once
+		if (battery_available)
+			LOG_INF("Battery %u%% (%d mV)", battery_pptt / 100, battery_mV);
+		else
+			LOG_INF("Battery not available (%d mV)", battery_mV);
+		if (abnormal_reading)
 		{
-			// log battery state once
-			if (battery_available)
-				LOG_INF("Battery %u%% (%d mV)", battery_pptt / 100, battery_mV);
-			else
-				LOG_INF("Battery not available (%d mV)", battery_mV);
-			if (abnormal_reading)
-			{
-				LOG_ERR("Battery voltage reading is abnormal");
-				set_status(SYS_STATUS_SYSTEM_ERROR, true);
-			}
-			set_regulator(SYS_REGULATOR_DCDC); // Switch to DCDC
-			power_init = true;
+			LOG_ERR("Battery voltage reading is abnormal");
+			set_status(SYS_STATUS_SYSTEM_ERROR, true);
 		}
+		set_regulator(SYS_REGULATOR_DCDC); // Switch to DCDC
+		power_init = true;
+	}
 
-		if (battery_discharged || docked)
+	if (battery_discharged || docked)
+	{
+		if (battery_discharged)
 		{
-			if (battery_discharged)
-			{
-				LOG_WRN("Discharged battery");
-				sys_update_battery_tracker(0, device_plugged);
-			}
-			sys_request_system_off();
+			LOG_WRN("Discharged battery");
+			sys_update_battery_tracker(0, device_plugged);
 		}
+		sys_request_system_off();
+	}
 
-		if (battery_available && !battery_low && battery_pptt < 1000)
-			battery_low = true;
-		else if (!battery_available || (battery_low && battery_pptt > 1500)) // hysteresis
-			battery_low = false;
+	if (battery_available && !battery_low && battery_pptt < 1000)
+	{
+		battery_low = true;
+		sys_flush(); // in case the battery runs out before shutdown
+	}
+	else if (!battery_available || (battery_low && battery_pptt > 1500)) // hysteresis
+		battery_low = false;
 
-		// Plugged state will cause a sudden change in SOC >10%, so reset the sample array
-		if (average_pptt >= 0 && NRFX_ABS(battery_pptt - average_pptt) > 1000)
-		{
-			LOG_INF("Change to battery SOC: %5.2f%% -> %5.2f%%", (double)average_pptt / 100.0, (double)battery_pptt / 100.0);
-			memset(last_pptt, -1, sizeof(last_pptt)); // reset array
-			samples = 1;
-		}
+	// Plugged state will cause a sudden change in SOC >10%, so reset the sample array
+	if (average_pptt >= 0 && NRFX_ABS(battery_pptt - average_pptt) > 1000)
+	{
+		LOG_INF("Change to battery SOC: %5.2f%% -> %5.2f%%", (double)average_pptt / 100.0, (double)battery_pptt / 100.0);
+		memset(last_pptt, -1, sizeof(last_pptt)); // reset array
+		samples = 1;
+	}
 
-		// Initalize sorted array
-		int16_t sorted_pptt[BATTERY_SAMPLES];
-		memcpy(sorted_pptt, last_pptt, sizeof(last_pptt));
-		sorted_pptt[BATTERY_SAMPLES - 1] = battery_pptt;
+	// Initalize sorted array
+	int16_t sorted_pptt[BATTERY_SAMPLES];
+	memcpy(sorted_pptt, last_pptt, sizeof(last_pptt));
+	sorted_pptt[BATTERY_SAMPLES - 1] = battery_pptt;
 
-		// Now add the last reading to the sample array
-		last_pptt[last_pptt_index] = battery_pptt;
-		last_pptt_index++;
-		last_pptt_index %= BATTERY_SAMPLES - 1;
+	// Now add the last reading to the sample array
+	last_pptt[last_pptt_index] = battery_pptt;
+	last_pptt_index++;
+	last_pptt_index %= BATTERY_SAMPLES - 1;
 
-		// Sort sample array
-		for (int i = 1; i < BATTERY_SAMPLES; i++)
+	// Sort sample array
+	for (int i = 1; i < BATTERY_SAMPLES; i++)
+	{
+		int16_t key = sorted_pptt[i];
+		int8_t j = i - 1;
+		while (j >= 0 && sorted_pptt[j] > key)
 		{
-			int16_t key = sorted_pptt[i];
-			int8_t j = i - 1;
-			while (j >= 0 && sorted_pptt[j] > key)
-			{
-				sorted_pptt[j + 1] = sorted_pptt[j];
-				j = j - 1;
-			}
-			sorted_pptt[j + 1] = key;
+			sorted_pptt[j + 1] = sorted_pptt[j];
+			j = j - 1;
 		}
+		sorted_pptt[j + 1] = key;
+	}
 
-		// Average across median 75% of samples
-		average_pptt = 0;
-		uint8_t valid_samples = 0;
-		for (uint8_t i = BATTERY_SAMPLES - (samples - samples / 8); i < (BATTERY_SAMPLES - samples / 8); i++)
+	// Average across median 75% of samples
+	average_pptt = 0;
+	uint8_t valid_samples = 0;
+	for (uint8_t i = BATTERY_SAMPLES - (samples - samples / 8); i < (BATTERY_SAMPLES - samples / 8); i++)
+	{
+		if (sorted_pptt[i] != -1)
 		{
-			if (sorted_pptt[i] != -1)
-			{
-				average_pptt += sorted_pptt[i];
-				valid_samples++;
-			}
+			average_pptt += sorted_pptt[i];
+			valid_samples++;
 		}
-		if (valid_samples > 0)
-			average_pptt /= valid_samples;
-		else
-			average_pptt = battery_pptt;
-
-		// Store the average battery level with hysteresis (Effectively 100-10000 -> 1-100%)
-		if (average_pptt + 100 < hysteresis_pptt) // Lower bound -100pptt
-			hysteresis_pptt = average_pptt + 100;
-		else if (average_pptt > hysteresis_pptt) // Upper bound +0pptt
-			hysteresis_pptt = average_pptt;
-
-		// 0% to battery tracker will reset it, as >1% to 0% is invalid change
-		// Instead, remap 1-100 to 0-100
-		current_battery_pptt = (hysteresis_pptt - 100) * 100 / 99;
-
-		sys_update_battery_tracker_voltage(battery_mV, device_plugged);
-		if (samples == BATTERY_SAMPLES || device_plugged)
-			sys_update_battery_tracker(current_battery_pptt, device_plugged);
-		calibrated_battery_pptt = sys_get_calibrated_battery_pptt(current_battery_pptt);
-
-		connection_update_battery(battery_available, device_plugged, calibrated_battery_pptt, battery_mV);
-
-		if (charging)
-			set_led(SYS_LED_PATTERN_PULSE_PERSIST, SYS_LED_PRIORITY_SYSTEM);
-		else if (charged)
-			set_led(SYS_LED_PATTERN_ON_PERSIST, SYS_LED_PRIORITY_SYSTEM);
-		else if (plugged || usb_plugged)
-			set_led(SYS_LED_PATTERN_PULSE_PERSIST, SYS_LED_PRIORITY_SYSTEM);
-		else if (battery_low)
-			set_led(SYS_LED_PATTERN_LONG_PERSIST, SYS_LED_PRIORITY_SYSTEM);
-		else
-			set_led(SYS_LED_PATTERN_ACTIVE_PERSIST, SYS_LED_PRIORITY_SYSTEM);
-//			set_led(SYS_LED_PATTERN_OFF, SYS_LED_PRIORITY_SYSTEM);
-
-		k_msleep(100);
 	}
+	if (valid_samples > 0)
+		average_pptt /= valid_samples;
+	else
+		average_pptt = battery_pptt;
+
+	// Store the average battery level with hysteresis (Effectively 100-10000 -> 1-100%)
+	if (average_pptt + 100 < hysteresis_pptt) // Lower bound -100pptt
+		hysteresis_pptt = average_pptt + 100;
+	else if (average_pptt > hysteresis_pptt) // Upper bound +0pptt
+		hysteresis_pptt = average_pptt;
+
+	// 0% to battery tracker will reset it, as >1% to 0% is invalid change
+	// Instead, remap 1-100 to 0-100
+	current_battery_pptt = (hysteresis_pptt - 100) * 100 / 99;
+
+	sys_update_battery_tracker_voltage(battery_mV, device_plugged);
+	if (samples == BATTERY_SAMPLES || device_plugged)
+		sys_update_battery_tracker(current_battery_pptt, device_plugged);
+	calibrated_battery_pptt = sys_get_calibrated_battery_pptt(current_battery_pptt);
+
+	connection_update_battery(battery_available, device_plugged, calibrated_battery_pptt, battery_mV);
+
+	if (charging)
+		set_led(SYS_LED_PATTERN_PULSE_PERSIST, SYS_LED_PRIORITY_SYSTEM);
+	else if (charged)
+		set_led(SYS_LED_PATTERN_ON_PERSIST, SYS_LED_PRIORITY_SYSTEM);
+	else if (plugged || usb_plugged)
+		set_led(SYS_LED_PATTERN_PULSE_PERSIST, SYS_LED_PRIORITY_SYSTEM);
+	else if (battery_low)
+		set_led(SYS_LED_PATTERN_LONG_PERSIST, SYS_LED_PRIORITY_SYSTEM);
+	else
+		set_led(SYS_LED_PATTERN_ACTIVE_PERSIST, SYS_LED_PRIORITY_SYSTEM);
+//		set_led(SYS_LED_PATTERN_OFF, SYS_LED_PRIORITY_SYSTEM);
+
+	k_work_schedule_for_queue(&sys_work_q, &power_work, sys_sleep_timeout(POWER_INTERVAL_MS));
 }
@@ -0,0 +1,127 @@
+#include "globals.h"
+
+#include <zephyr/kernel.h>
+
+#include "sleep.h"
+
+#define SLEEP_GRID_MS 10 // wake up grid while the sensor loop is not running
+
+static struct k_spinlock sleep_lock;
+
+// Sensor loop wake up, other periodic work is moved onto the same ticks
+static int64_t sleep_anchor = 0;
+static uint32_t sleep_period = 0;
+
+static uint32_t sleep_aligned = 0;
+static uint32_t sleep_unaligned = 0;
+
+void sys_sleep_set_anchor(int64_t wake_ticks, uint32_t period_ticks)
+{
+	k_spinlock_key_t key = k_spin_lock(&sleep_lock);
+	sleep_anchor = wake_ticks;
+	sleep_period = period_ticks;
+	k_spin_unlock(&sleep_lock, key);
+}
+
+// Timeout for periodic work that may run up to a quarter of its delay late, on the next sensor loop wake up
+k_timeout_t sys_sleep_timeout(uint32_t delay_ms)
+{
+#if CONFIG_SYS_SLEEP_ALIGN
+	int64_t target = k_uptime_ticks() + k_ms_to_ticks_ceil64(delay_ms);
+	uint32_t slack = k_ms_to_ticks_floor32(delay_ms / 4);
+	k_spinlock_key_t key = k_spin_lock(&sleep_lock);
+	int64_t anchor = sleep_anchor;
+	uint32_t period = sleep_period;
+	if (period == 0) // not running, align to a fixed grid so other work is still grouped
+	{
+		anchor = 0;
+		period = k_ms_to_ticks_ceil32(SLEEP_GRID_MS);
+	}
+	int64_t offset = (target - anchor) % period;
+	if (offset < 0)
+		offset += period;
+	int64_t aligned = offset ? target + (period - offset) : target;
+	bool align = aligned - target <= slack;
+	if (align)
+		sleep_aligned++;
+	else
+		sleep_unaligned++;
+	k_spin_unlock(&sleep_lock, key);
+	return K_TIMEOUT_ABS_TICKS(align ? aligned : target);
+#else
+	return K_MSEC(delay_ms);
+#endif
+}
+
+#if CONFIG_SYS_SLEEP_STATS
+static const char *const sleep_state_names[SYS_SLEEP_STATE_COUNT] = {
+	"Low noise",
+	"Low power",
+	"Low power 2",
+	"Suspended",
+};
+
+static enum sys_sleep_state sleep_state = SYS_SLEEP_STATE_SUSPENDED;
+static uint64_t sleep_idle_cycles[SYS_SLEEP_STATE_COUNT];
+static uint64_t sleep_total_cycles[SYS_SLEEP_STATE_COUNT];
+static uint64_t sleep_last_idle = 0;
+static uint64_t sleep_last_total = 0;
+
+// Add the time since the last call to the current state, call with sleep_lock held
+static void sleep_account(void)
+{
+	k_thread_runtime_stats_t stats;
+	if (k_thread_runtime_stats_all_get(&stats))
+		return;
+	sleep_idle_cycles[sleep_state] += stats.idle_cycles - sleep_last_idle;
+	sleep_total_cycles[sleep_state] += stats.execution_cycles - sleep_last_total; // idle and non-idle
+	sleep_last_idle = stats.idle_cycles;
+	sleep_last_total = stats.execution_cycles;
+}
+#endif
+
+void sys_sleep_set_state(enum sys_sleep_state state)
+{
+#if CONFIG_SYS_SLEEP_STATS
+	k_spinlock_key_t key = k_spin_lock(&sleep_lock);
+	if (state != sleep_state)
+	{
+		sleep_account();
+		sleep_state = state;
+	}
+	k_spin_unlock(&sleep_lock, key);
+#endif
+}
+
+void sys_sleep_print(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&sleep_lock);
+	uint32_t aligned = sleep_aligned;
+	uint32_t unaligned = sleep_unaligned;
+#if CONFIG_SYS_SLEEP_STATS
+	sleep_account();
+	uint64_t idle_cycles[SYS_SLEEP_STATE_COUNT];
+	uint64_t total_cycles[SYS_SLEEP_STATE_COUNT];
+	memcpy(idle_cycles, sleep_idle_cycles, sizeof(idle_cycles));
+	memcpy(total_cycles, sleep_total_cycles, sizeof(total_cycles));
+	enum sys_sleep_state state = sleep_state;
+#endif
+	k_spin_unlock(&sleep_lock, key);
+
+#if CONFIG_SYS_SLEEP_STATS
+	printk("State        Time         Idle\n");
+	for (int i = 0; i < SYS_SLEEP_STATE_COUNT; i++)
+	{
+		if (total_cycles[i])
+		{
+			uint32_t permille = idle_cycles[i] * 1000 / total_cycles[i];
+			printk("%-12s %8llums %3u.%u%%%s\n", sleep_state_names[i], k_cyc_to_ms_floor64(total_cycles[i]), permille / 10, permille % 10, i == state ? " (current)" : "");
+		}
+		else
+			printk("%-12s Not entered\n", sleep_state_names[i]);
+	}
+#else
+	printk("Idle statistics not enabled\n");
+#endif
+	printk("\nAligned wake ups: %u of %u\n", aligned, aligned + unaligned);
+}
@@ -0,0 +1,20 @@
+#ifndef SLIMENRF_SYSTEM_SLEEP
+#define SLIMENRF_SYSTEM_SLEEP
+
+#include <zephyr/kernel.h>
+
+enum sys_sleep_state {
+	SYS_SLEEP_STATE_LOW_NOISE, // sensor at full rate
+	SYS_SLEEP_STATE_LOW_POWER, // sensor in low power during no motion
+	SYS_SLEEP_STATE_LOW_POWER_2,
+	SYS_SLEEP_STATE_SUSPENDED, // sensor loop not running
+	SYS_SLEEP_STATE_COUNT
+};
+
+void sys_sleep_set_anchor(int64_t wake_ticks, uint32_t period_ticks);
+k_timeout_t sys_sleep_timeout(uint32_t delay_ms);
+
+void sys_sleep_set_state(enum sys_sleep_state state);
+void sys_sleep_print(void);
+
+#endif
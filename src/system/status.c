@@ -5,13 +5,19 @@
 
 #include "status.h"
 #include "led.h"
+#include "sleep.h"
+#include "work.h"
 
 static int status_state = 0;
 
 LOG_MODULE_REGISTER(status, LOG_LEVEL_INF);
 
-static void status_thread(void);
-K_THREAD_DEFINE(status_thread_id, 256, status_thread, NULL, NULL, NULL, 6, 0, 0);
+#define STATUS_ERRORS (SYS_STATUS_SENSOR_ERROR | SYS_STATUS_CONNECTION_ERROR | SYS_STATUS_SYSTEM_ERROR)
+
+static int status_cycle = 0; // next error to show
+
+static void status_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(status_work, status_work_handler);
 
 void set_status(enum sys_status status, bool set) {
 	if (set) {
@@ -48,6 +54,8 @@ void set_status(enum sys_status status, bool set) {
 	}
 	connection_update_status(status_state);
 	LOG_INF("Status: %d", status_state);
+	if (status & STATUS_ERRORS)
+		k_work_schedule_for_queue(&sys_work_q, &status_work, K_NO_WAIT); // no effect if an error is already shown
 }
 
 bool get_status(enum sys_status status)
@@ -55,30 +63,23 @@ bool get_status(enum sys_status status)
 	return status_state & status;
 }
 
-static void status_thread(void)
+static void status_work_handler(struct k_work *work)
 {
-	while (1) // cycle through errors
+	static const int errors[] = {SYS_STATUS_SENSOR_ERROR, SYS_STATUS_CONNECTION_ERROR, SYS_STATUS_SYSTEM_ERROR};
+	static const enum sys_led_pattern patterns[] = {SYS_LED_PATTERN_ERROR_A, SYS_LED_PATTERN_ERROR_B, SYS_LED_PATTERN_ERROR_C};
+	for (int i = 0; i < ARRAY_SIZE(errors); i++) // cycle through errors
 	{
-		int status = status_state
-				   & (SYS_STATUS_SENSOR_ERROR | SYS_STATUS_CONNECTION_ERROR
-					  | SYS_STATUS_SYSTEM_ERROR);
-		if (status & SYS_STATUS_SENSOR_ERROR) {
-			set_led(SYS_LED_PATTERN_ERROR_A, SYS_LED_PRIORITY_STATUS);
-			k_msleep(5000);
-		}
-		if (status & SYS_STATUS_CONNECTION_ERROR) {
-			set_led(SYS_LED_PATTERN_ERROR_B, SYS_LED_PRIORITY_STATUS);
-			k_msleep(5000);
-		}
-		if (status & SYS_STATUS_SYSTEM_ERROR) {
-			set_led(SYS_LED_PATTERN_ERROR_C, SYS_LED_PRIORITY_STATUS);
-			k_msleep(5000);
-		}
-		if (!status) {
-			set_led(SYS_LED_PATTERN_OFF, SYS_LED_PRIORITY_STATUS);
-			k_msleep(100);
+		int index = (status_cycle + i) % ARRAY_SIZE(errors);
+		if (status_state & errors[index])
+		{
+			set_led(patterns[index], SYS_LED_PRIORITY_STATUS);
+			status_cycle = index + 1;
+			k_work_schedule_for_queue(&sys_work_q, &status_work, sys_sleep_timeout(5000));
+			return;
 		}
 	}
+	set_led(SYS_LED_PATTERN_OFF, SYS_LED_PRIORITY_STATUS);
+	status_cycle = 0; // idle until the next error is set
 }
 
 bool status_ready(void)  // true if no important statuses are active
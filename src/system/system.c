@@ -13,6 +13,7 @@
 #include <hal/nrf_gpio.h>
 
 #include "system.h"
+#include "work.h"
 
 static struct nvs_fs fs;
 
@@ -143,6 +144,45 @@ static inline void sys_nvs_init(void)
 	nvs_init = true;
 }
 
+#if CONFIG_SYS_NVS_WRITE_BACK
+struct sys_nvs_cache_entry {
+	uint16_t id;
+	uint16_t offset; // in retained
+	uint16_t len;
+};
+
+// NVS entries with a copy in retained, written back to NVS after CONFIG_SYS_NVS_WRITE_BACK_DELAY
+// Pairing is not deferred, it cannot be recovered if lost
+static const struct sys_nvs_cache_entry sys_nvs_cache[] = {
+	{MAIN_ACCEL_BIAS_ID, offsetof(struct retained_data, accelBias), sizeof(retained->accelBias)},
+	{MAIN_GYRO_BIAS_ID, offsetof(struct retained_data, gyroBias), sizeof(retained->gyroBias)},
+	{MAIN_MAG_BIAS_ID, offsetof(struct retained_data, magBAinv), sizeof(retained->magBAinv)},
+	{MAIN_GYRO_SENS_ID, offsetof(struct retained_data, gyroSensScale), sizeof(retained->gyroSensScale)},
+	{MAIN_ACC_6_BIAS_ID, offsetof(struct retained_data, accBAinv), sizeof(retained->accBAinv)},
+	{MAIN_SENSOR_DATA_ID, offsetof(struct retained_data, sensor_data), sizeof(retained->sensor_data)},
+	{BATT_STATS_CURVE_ID, offsetof(struct retained_data, battery_pptt_curve), sizeof(retained->battery_pptt_curve)},
+};
+
+#define SYS_NVS_CACHE_MAX_LEN sizeof(retained->sensor_data) // largest entry
+
+static K_MUTEX_DEFINE(sys_nvs_lock);
+
+static void sys_flush_work_handler(struct k_work *work)
+{
+	sys_flush();
+}
+
+static K_WORK_DELAYABLE_DEFINE(sys_flush_work, sys_flush_work_handler);
+
+static const struct sys_nvs_cache_entry *sys_nvs_cache_get(uint16_t id)
+{
+	for (int i = 0; i < ARRAY_SIZE(sys_nvs_cache); i++)
+		if (sys_nvs_cache[i].id == id)
+			return &sys_nvs_cache[i];
+	return NULL;
+}
+#endif
+
 static bool ram_retention_valid = false;
 
 static int sys_retained_init(void)
@@ -158,17 +198,37 @@ static int sys_retained_init(void)
 	// All contents of NVS was stored in RAM to not need initializing NVS often
 	if (!retained_validate()) // Check ram retention
 	{ 
-		LOG_WRN("Invalidated RAM");
 		sys_nvs_init();
-		// read from nvs to retained
-		sys_read(PAIRED_ID, &retained->paired_addr, sizeof(retained->paired_addr));
-		sys_read(MAIN_SENSOR_DATA_ID, &retained->sensor_data, sizeof(retained->sensor_data));
-		sys_read(MAIN_ACCEL_BIAS_ID, &retained->accelBias, sizeof(retained->accelBias));
-		sys_read(MAIN_GYRO_BIAS_ID, &retained->gyroBias, sizeof(retained->gyroBias));
-		sys_read(MAIN_MAG_BIAS_ID, &retained->magBAinv, sizeof(retained->magBAinv));
-		sys_read(MAIN_ACC_6_BIAS_ID, &retained->accBAinv, sizeof(retained->accBAinv));
-		sys_read(BATT_STATS_CURVE_ID, &retained->battery_pptt_curve, sizeof(retained->battery_pptt_curve));
-		nvs_read(&fs, MAIN_GYRO_SENS_ID, &retained->gyroSensScale, sizeof(retained->gyroSensScale));
+		// read invalidated sections from nvs to retained, the retained copy of pending writes is lost
+		if (!retained_section_valid(RETAINED_SECTION_PAIRING))
+		{
+			LOG_WRN("Invalidated pairing in RAM");
+			sys_read(PAIRED_ID, &retained->paired_addr, sizeof(retained->paired_addr));
+		}
+		if (!retained_section_valid(RETAINED_SECTION_CALIBRATION))
+		{
+			LOG_WRN("Invalidated calibration in RAM");
+			retained->nvs_dirty &= ~(BIT(MAIN_SENSOR_DATA_ID) | BIT(MAIN_ACCEL_BIAS_ID) | BIT(MAIN_GYRO_BIAS_ID) | BIT(MAIN_MAG_BIAS_ID) | BIT(MAIN_ACC_6_BIAS_ID) | BIT(MAIN_GYRO_SENS_ID));
+			sys_read(MAIN_SENSOR_DATA_ID, &retained->sensor_data, sizeof(retained->sensor_data));
+			sys_read(MAIN_ACCEL_BIAS_ID, &retained->accelBias, sizeof(retained->accelBias));
+			sys_read(MAIN_GYRO_BIAS_ID, &retained->gyroBias, sizeof(retained->gyroBias));
+			sys_read(MAIN_MAG_BIAS_ID, &retained->magBAinv, sizeof(retained->magBAinv));
+			sys_read(MAIN_ACC_6_BIAS_ID, &retained->accBAinv, sizeof(retained->accBAinv));
+			int len = nvs_read(&fs, MAIN_GYRO_SENS_ID, &retained->gyroSensScale, sizeof(retained->gyroSensScale));
+			if (len == sizeof(retained->gyroSensScale[0])) // single scale stored before it was kept per range, it was used at every range
+			{
+				for (int i = 1; i < GYRO_SENS_RANGES; i++)
+					memcpy(retained->gyroSensScale[i], retained->gyroSensScale[0], sizeof(retained->gyroSensScale[0]));
+			}
+		}
+		if (!retained_section_valid(RETAINED_SECTION_BATTERY))
+		{
+			LOG_WRN("Invalidated battery statistics in RAM");
+			retained->nvs_dirty &= ~BIT(BATT_STATS_CURVE_ID);
+			sys_read(BATT_STATS_CURVE_ID, &retained->battery_pptt_curve, sizeof(retained->battery_pptt_curve));
+		}
+		if (!retained_section_valid(RETAINED_SECTION_SYSTEM))
+			LOG_WRN("Invalidated RAM");
 		retained_update();
 	}
 	else
@@ -176,6 +236,11 @@ static int sys_retained_init(void)
 		LOG_INF("Validated RAM");
 		ram_retention_valid = true;
 	}
+	sys_boot_init(reset_pin_reset);
+#if CONFIG_SYS_NVS_WRITE_BACK
+	if (retained->nvs_dirty) // not flushed before reset
+		k_work_schedule_for_queue(&sys_work_q, &sys_flush_work, K_NO_WAIT);
+#endif
 	return 0;
 }
 
@@ -188,7 +253,7 @@ uint8_t reboot_counter_read(void)
 	{
 		sys_nvs_init();
 		nvs_read(&fs, RBT_CNT_ID, &retained->reboot_counter, sizeof(retained->reboot_counter));
-		retained_update();
+		retained_update_section(RETAINED_SECTION_SYSTEM);
 	}
 	return retained->reboot_counter;
 }
@@ -202,12 +267,33 @@ void reboot_counter_write(uint8_t reboot_counter)
 		sys_nvs_init();
 		nvs_write(&fs, RBT_CNT_ID, &retained->reboot_counter, sizeof(retained->reboot_counter));
 	}
-	retained_update();
+	retained_update_section(RETAINED_SECTION_SYSTEM);
 }
 
-// write to retained and nvs
+// write to retained and nvs, entries kept in retained are written to nvs later
 void sys_write(uint16_t id, void *retained_ptr, const void *data, size_t len)
 {
+#if CONFIG_SYS_NVS_WRITE_BACK
+	const struct sys_nvs_cache_entry *entry = sys_nvs_cache_get(id);
+	k_mutex_lock(&sys_nvs_lock, K_FOREVER);
+	if (entry && retained_ptr == (uint8_t *)retained + entry->offset && len == entry->len)
+	{
+		if (retained_ptr != data && !(retained->nvs_dirty & BIT(id)) && !memcmp(retained_ptr, data, len))
+		{
+			k_mutex_unlock(&sys_nvs_lock);
+			return; // unchanged
+		}
+		memmove(retained_ptr, data, len);
+		retained->nvs_dirty |= BIT(id);
+		retained_update_at(retained_ptr); // also updates nvs_dirty in the system section
+		k_mutex_unlock(&sys_nvs_lock);
+		k_work_reschedule_for_queue(&sys_work_q, &sys_flush_work, K_MSEC(CONFIG_SYS_NVS_WRITE_BACK_DELAY)); // coalesce writes
+		return;
+	}
+	if (id < 32)
+		retained->nvs_dirty &= ~BIT(id); // written through, the last write wins
+	k_mutex_unlock(&sys_nvs_lock);
+#endif
 	sys_nvs_init();
 	if (retained_ptr)
 		memcpy(retained_ptr, data, len);
@@ -218,11 +304,19 @@ void sys_write(uint16_t id, void *retained_ptr, const void *data, size_t len)
 		return;
 	}
 	if (retained_ptr)
-		retained_update();
+		retained_update_at(retained_ptr);
 }
 
 void sys_read(uint16_t id, void *data, size_t len)
 {
+#if CONFIG_SYS_NVS_WRITE_BACK
+	const struct sys_nvs_cache_entry *entry = sys_nvs_cache_get(id);
+	if (entry && (retained->nvs_dirty & BIT(id)) && len == entry->len)
+	{
+		memcpy(data, (uint8_t *)retained + entry->offset, len); // not written to nvs yet
+		return;
+	}
+#endif
 	sys_nvs_init();
 	int err = nvs_read(&fs, id, data, len);
 	if (err < 0)
@@ -241,6 +335,47 @@ void sys_read(uint16_t id, void *data, size_t len)
 	}
 }
 
+// write all pending entries to nvs, skipping entries that are unchanged
+void sys_flush(void)
+{
+#if CONFIG_SYS_NVS_WRITE_BACK
+	k_mutex_lock(&sys_nvs_lock, K_FOREVER);
+	if (!retained->nvs_dirty)
+	{
+		k_mutex_unlock(&sys_nvs_lock);
+		return;
+	}
+	sys_nvs_init();
+	int written = 0;
+	int unchanged = 0;
+	for (int i = 0; i < ARRAY_SIZE(sys_nvs_cache); i++)
+	{
+		const struct sys_nvs_cache_entry *entry = &sys_nvs_cache[i];
+		if (!(retained->nvs_dirty & BIT(entry->id)))
+			continue;
+		const uint8_t *ptr = (uint8_t *)retained + entry->offset;
+		uint8_t stored[SYS_NVS_CACHE_MAX_LEN];
+		retained->nvs_dirty &= ~BIT(entry->id);
+		if (nvs_read(&fs, entry->id, stored, entry->len) == entry->len && !memcmp(stored, ptr, entry->len))
+		{
+			unchanged++;
+			continue;
+		}
+		int err = nvs_write(&fs, entry->id, ptr, entry->len);
+		if (err < 0)
+		{
+			LOG_ERR("Failed to write to NVS, error: %d", err);
+			retained->nvs_dirty |= BIT(entry->id); // retry on next flush
+			continue;
+		}
+		written++;
+	}
+	retained_update_section(RETAINED_SECTION_SYSTEM);
+	k_mutex_unlock(&sys_nvs_lock);
+	LOG_INF("Flushed NVS: %d written, %d unchanged", written, unchanged);
+#endif
+}
+
 void sys_clear(void)
 {
 	
@@ -474,6 +609,7 @@ void sys_reset_mode(uint8_t mode)
 		sys_request_system_reboot();
 #endif
 #if NRF5_BOOTLOADER
+		sys_flush(); // the bootloader is entered by a reset, write pending NVS entries first
 		gpio_pin_configure(gpio_dev, 19, GPIO_OUTPUT | GPIO_OUTPUT_INIT_LOW);
 #endif
 #endif
@@ -1,8 +1,10 @@
 #ifndef SLIMENRF_SYSTEM
 #define SLIMENRF_SYSTEM
 
+#include "boot.h"
 #include "led.h"
 #include "power.h"
+#include "sleep.h"
 #include "status.h"
 
 #define RBT_CNT_ID 1
@@ -18,6 +20,8 @@
 #define BATT_STATS_INTERVAL_0 9 // ID 9 to 28
 #define BATT_STATS_CURVE_ID 29
 
+#define RECEIVER_TRACKERS_ID 30
+
 void configure_sense_pins(void);
 
 uint8_t reboot_counter_read(void);
@@ -25,6 +29,7 @@ void reboot_counter_write(uint8_t reboot_counter);
 
 void sys_write(uint16_t id, void *ptr, const void *data, size_t len);
 void sys_read(uint16_t id, void *data, size_t len);
+void sys_flush(void);
 void sys_clear(void);
 
 int set_sensor_clock(bool enable, float rate, float* actual_rate);
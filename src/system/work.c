@@ -0,0 +1,49 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2025 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#include "globals.h"
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include "work.h"
+
+// Shared by work that used to run in its own thread, sized for the deepest handler (battery and system off)
+#define SYS_WORK_STACK_SIZE 1280
+#define SYS_WORK_HIGH_STACK_SIZE 256
+
+struct k_work_q sys_work_q;
+struct k_work_q sys_work_q_high;
+
+static K_THREAD_STACK_DEFINE(sys_work_q_stack, SYS_WORK_STACK_SIZE);
+static K_THREAD_STACK_DEFINE(sys_work_q_high_stack, SYS_WORK_HIGH_STACK_SIZE);
+
+static int sys_work_init(void)
+{
+	const struct k_work_queue_config config = {.name = "sys_work_q", .no_yield = false};
+	const struct k_work_queue_config config_high = {.name = "sys_work_q_high", .no_yield = false};
+	k_work_queue_start(&sys_work_q, sys_work_q_stack, K_THREAD_STACK_SIZEOF(sys_work_q_stack), 6, &config);
+	k_work_queue_start(&sys_work_q_high, sys_work_q_high_stack, K_THREAD_STACK_SIZEOF(sys_work_q_high_stack), 5, &config_high);
+	return 0;
+}
+
+SYS_INIT(sys_work_init, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT); // before any work is scheduled by the application
@@ -58,6 +58,18 @@ void q_negate(const float* q, float* out) {
 	out[3] = -q[3];
 }
 
+// Rotation over dt at constant angular velocity g (deg/s)
+void q_from_gyro(const float* g, float dt, float* out) {
+	float half_dt = dt * (M_PI / 360);  // deg to rad, half angle
+	float v[3] = {g[0] * half_dt, g[1] * half_dt, g[2] * half_dt};
+	float mag = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	float s = mag < EPS ? 1 : sinf(mag) / mag;  // small angle
+	out[0] = cosf(mag);
+	out[1] = s * v[0];
+	out[2] = s * v[1];
+	out[3] = s * v[2];
+}
+
 float q_diff_mag(const float* x, const float* y) {
 	float z[4];
 	float q[4];
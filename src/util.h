@@ -53,6 +53,7 @@ void q_normalize(const float* q, float* out);
 void q_multiply(const float* x, const float* y, float* out);
 void q_conj(const float* q, float* out);
 void q_negate(const float* q, float* out);
+void q_from_gyro(const float* g, float dt, float* out);
 float q_diff_mag(const float* x, const float* y);
 void v_rotate(const float* v, const float* q, float* out);
 float v_avg(const float* a);